@@ -24,9 +24,28 @@
 
 #include "SweatCI.h"
 
-#include <regex>
 #include <algorithm>
+#include <cstdlib>
 #include <fstream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include <new>
+#include <cstddef>
+#include <ctime>
+
+#include <sys/stat.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SWEATCI_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
 
 namespace SweatCI {
     std::string tokenTypeToString(const TokenType& type) {
@@ -46,28 +65,23 @@ namespace SweatCI {
         return "UNKNOWN";
     }
 
-    Token::Token() {}
-    Token::~Token() {}
-
-    Token::Token(const Token& other) : type(other.type), value(other.value) {}
-
     Token::Token(const TokenType& type, const std::string& value) : type(type), value(value) {}
 
-    Token& Token::operator=(const Token& other) {
-        type = other.type;
-        value = other.value;
-
-        return *this;
-    }
+    Token::Token(const TokenType& type, std::string&& value) : type(type), value(std::move(value)) {}
 
     const TokenType& Token::getType() const {
         return type;
     }
 
-    const std::string& Token::getValue() {
+    const std::string& Token::getValue() const {
         return value;
     }
 
+    void Token::set(TokenType newType, const char* pValue, size_t size) {
+        type = newType;
+        value.assign(pValue, size);
+    }
+
     std::string Token::string() const {
         return "Token(" + tokenTypeToString(type) + ", \"" + value + "\")";
     }
@@ -88,31 +102,450 @@ namespace SweatCI {
         printf(OutputLevel::_ERROR, "unknown command \"{}\"\n", command);
     }
 
+    static void printInvalidName(const std::string& name) {
+        printf(OutputLevel::_ERROR, "\"{}\" is not a valid name\n", name);
+    }
+
+    static void* defaultAllocate(void*, size_t size) {
+        return ::operator new(size);
+    }
+
+    static void defaultDeallocate(void*, void* pMemory, size_t) {
+        ::operator delete(pMemory);
+    }
+
+    static Allocator allocator = {defaultAllocate, defaultDeallocate, nullptr};
+    static std::atomic<size_t> allocationsInUse{0};
+
+    bool setAllocator(const Allocator& newAllocator) {
+        if (allocationsInUse.load() != 0 || newAllocator.allocate == nullptr || newAllocator.deallocate == nullptr)
+            return false;
+
+        allocator = newAllocator;
+        return true;
+    }
+
+    const Allocator& getAllocator() {
+        return allocator;
+    }
+
+    void* _allocate(size_t size) {
+        void* pMemory = allocator.allocate(allocator.pData, size);
+        if (pMemory == nullptr)
+            throw std::bad_alloc();
+
+        allocationsInUse.fetch_add(1, std::memory_order_relaxed);
+        return pMemory;
+    }
+
+    void _deallocate(void* pMemory, size_t size) {
+        if (pMemory == nullptr)
+            return;
+
+        allocator.deallocate(allocator.pData, pMemory, size);
+        allocationsInUse.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /*
+     * Alias lexers are popped in the opposite order they were pushed, so they live in a stack of slots, in blocks that are
+     * taken from the Allocator once and kept. The Lexer of an alias that ended stays in its slot and the next alias resets
+     * it, so calling an alias reuses the input, arguments and file path of the last one instead of allocating its own.
+     * Freeing one that is not on top only waits for the ones above it.
+     */
+    class LexerArena {
+    public:
+        ~LexerArena() {
+            while (constructed > 0)
+                slot(--constructed)->~Lexer();
+
+            for (auto pBlock : blocks)
+                _deallocate(pBlock, sizeof(Lexer) * slotsPerBlock);
+        }
+
+        template<typename ... Args>
+        Lexer* push(Args&& ... args) {
+            if (top == blocks.size() * slotsPerBlock) {
+                blocks.push_back(_allocate(sizeof(Lexer) * slotsPerBlock));
+                ended.resize(blocks.size() * slotsPerBlock, false);
+            }
+
+            Lexer* pLexer = slot(top);
+            if (top < constructed)
+                reuse(pLexer, std::forward<Args>(args)...);
+            else {
+                new (pLexer) Lexer(std::forward<Args>(args)...);
+                ++constructed;
+            }
+
+            ++top;
+            return pLexer;
+        }
+
+        void pop(Lexer* pLexer) {
+            size_t index = top;
+            while (index > 0 && slot(index - 1) != pLexer)
+                --index;
+
+            if (index == 0)
+                return;
+
+            ended[index - 1] = true;
+            while (top > 0 && ended[top - 1])
+                ended[--top] = false;
+
+            // only a few are kept for the next aliases, a deep recursion does not hold its inputs forever
+            while (constructed > top + keptLexers)
+                slot(--constructed)->~Lexer();
+        }
+
+    private:
+        static void reuse(Lexer* pLexer, const CommandContext& ctx, const std::string& input) {
+            pLexer->reset(ctx, input.data(), input.size());
+        }
+
+        static void reuse(Lexer* pLexer, const Lexer& other) {
+            *pLexer = other;
+        }
+
+        Lexer* slot(size_t index) {
+            return static_cast<Lexer*>(blocks[index / slotsPerBlock]) + index % slotsPerBlock;
+        }
+
+        static constexpr size_t slotsPerBlock = 32;
+        static constexpr size_t keptLexers = 16;
+
+        std::vector<void*> blocks;
+        std::vector<char> ended; // popped, but a Lexer above it was not
+        size_t top = 0; // slots in use
+        size_t constructed = 0; // slots with a Lexer, the ones from top on wait for the next aliases
+    };
+
+    constexpr size_t LexerArena::slotsPerBlock;
+    constexpr size_t LexerArena::keptLexers;
+
+    // each thread parses with its own
+    static thread_local LexerArena lexerArena;
+
+    template<typename ... Args>
+    static Lexer* newAliasLexer(Args&& ... args) {
+        return lexerArena.push(std::forward<Args>(args)...);
+    }
+
+    static void deleteAliasLexer(Lexer* pLexer) {
+        lexerArena.pop(pLexer);
+    }
+
+    Arguments::Arguments(std::initializer_list<std::string> arguments) {
+        for (const auto& argument : arguments)
+            push_back(argument);
+    }
+
+    Arguments::Arguments(const std::vector<std::string>& arguments) {
+        for (const auto& argument : arguments)
+            push_back(argument);
+    }
+
+    Arguments::Arguments(const Arguments& other) {
+        for (const auto& argument : other)
+            push_back(argument);
+    }
+
+    Arguments& Arguments::operator=(const Arguments& other) {
+        if (this == &other)
+            return *this;
+
+        clear();
+        for (const auto& argument : other)
+            push_back(argument);
+
+        return *this;
+    }
+
+    std::string& Arguments::nextSlot() {
+        if (pData == inlineArguments) {
+            if (count < inlineCapacity)
+                return inlineArguments[count++];
+
+            heapArguments.reserve(inlineCapacity * 2);
+            for (auto& argument : inlineArguments)
+                heapArguments.push_back(std::move(argument));
+        }
+
+        if (count == heapArguments.size())
+            heapArguments.emplace_back();
+
+        pData = heapArguments.data();
+        return heapArguments[count++];
+    }
+
+    void Arguments::push_back(const std::string& argument) {
+        // nextSlot may move the strings, including argument if it's one of them
+        if (&argument >= begin() && &argument < end()) {
+            std::string copy = argument;
+            nextSlot() = std::move(copy);
+        } else
+            nextSlot() = argument;
+    }
+
+    void Arguments::push_back(std::string&& argument) {
+        nextSlot() = std::move(argument);
+    }
+
+    std::string& Arguments::emplace_back() {
+        std::string& slot = nextSlot();
+        slot.clear();
+        return slot;
+    }
+
+    void Arguments::pop_back() {
+        --count;
+    }
+
+    std::string& Arguments::at(size_t index) {
+        if (index >= count)
+            throw std::out_of_range("Arguments::at");
+
+        return pData[index];
+    }
+
+    const std::string& Arguments::at(size_t index) const {
+        if (index >= count)
+            throw std::out_of_range("Arguments::at");
+
+        return pData[index];
+    }
+
+    Arguments::iterator Arguments::insert(const_iterator position, const std::string& argument) {
+        size_t index = position - begin();
+        push_back(argument);
+        std::rotate(begin() + index, end() - 1, end());
+
+        return begin() + index;
+    }
+
+    Arguments::iterator Arguments::insert(const_iterator position, std::string&& argument) {
+        size_t index = position - begin();
+        push_back(std::move(argument));
+        std::rotate(begin() + index, end() - 1, end());
+
+        return begin() + index;
+    }
+
+    Arguments::iterator Arguments::erase(const_iterator position) {
+        return erase(position, position + 1);
+    }
+
+    Arguments::iterator Arguments::erase(const_iterator first, const_iterator last) {
+        size_t index = first - begin();
+        size_t erased = last - first;
+
+        // the erased strings go after the end instead of being freed, like clear
+        std::rotate(begin() + index, begin() + index + erased, end());
+        count -= erased;
+
+        return begin() + index;
+    }
+
+    void Arguments::resize(size_t newCount) {
+        if (newCount < count)
+            count = newCount;
+
+        while (count < newCount)
+            emplace_back();
+    }
+
+    void Arguments::clear() {
+        count = 0;
+    }
+
+    Arguments::operator std::vector<std::string>() const {
+        return std::vector<std::string>(begin(), end());
+    }
+
+    /*
+     * Commands are found through the tables given to registerCommands first and then through a hash index of every
+     * other command, which is rebuilt when it is out of date. When two commands have the same name the first one is found.
+     */
+    struct CommandTableIndex {
+        const void* pTable;
+        long (*find)(const void* pTable, const std::string& name);
+        size_t first; // where the table's first entry is in Command::commands
+        size_t count;
+    };
+
+    static std::vector<CommandTableIndex> commandTables;
+    static std::vector<std::string> commandUsages; // see Command::usageIndex, cleared with Command::clear
+    static std::vector<unsigned short> commandUsageGenerations; // one for each slot in commandUsages
+    static std::vector<unsigned int> freeCommandUsages; // slots of deleted commands, used before commandUsages grows
+    static unsigned short nextUsageGeneration = 0; // never reset, so copies from before Command::clear do not match the new slots
+    static unsigned long long commandsRemoved = 0; // see CommandHandle, indexes of commands only change when one is removed
+    static HostMap<const char*, std::string> commandTableUsages; // see Command::pTableUsage, made the first time they are asked for
+    static HostMap<std::string, size_t> commandIndex; // every command that is not found through a table
+    static size_t indexedCommandCount = 0; // commands in commandIndex or a table, it is rebuilt when it is not Command::commands.size()
+
+    static void updateCommandIndex() {
+        if (indexedCommandCount == Command::commands.size())
+            return;
+
+        // commandTables are in the same order as their entries in Command::commands
+        commandIndex.clear();
+        commandIndex.reserve(Command::commands.size());
+        size_t table = 0;
+        for (size_t i = 0; i < Command::commands.size(); ++i) {
+            if (table < commandTables.size() && i == commandTables[table].first) {
+                i += commandTables[table++].count - 1;
+                continue;
+            }
+
+            commandIndex.emplace(Command::commands[i].name, i);
+        }
+
+        indexedCommandCount = Command::commands.size();
+    }
+
+    static void indexLastCommand() {
+        if (indexedCommandCount + 1 != Command::commands.size())
+            return; // rebuilt on the next lookup
+
+        commandIndex.emplace(Command::commands.back().name, indexedCommandCount);
+        ++indexedCommandCount;
+    }
+
+    /// @brief makes room for count more commands without growing the vector one by one
+    static void reserveCommands(size_t count) {
+        size_t needed = Command::commands.size() + count;
+        if (needed > Command::commands.capacity())
+            Command::commands.reserve(std::max(needed, Command::commands.capacity() * 2));
+    }
+
+    /// @brief puts usage in a free slot and makes it the one of command
+    static void storeUsage(Command& command, const std::string& usage) {
+        if (freeCommandUsages.empty()) {
+            command.usageIndex = static_cast<unsigned int>(commandUsages.size());
+            commandUsages.push_back(usage);
+            commandUsageGenerations.push_back(0);
+        } else {
+            command.usageIndex = freeCommandUsages.back();
+            freeCommandUsages.pop_back();
+            commandUsages[command.usageIndex] = usage;
+        }
+
+        command.usageGeneration = commandUsageGenerations[command.usageIndex] = nextUsageGeneration++;
+        command.pPendingUsage.reset();
+        command.pTableUsage = nullptr;
+    }
+
+    static void freeUsage(const Command& command) {
+        if (command.usageIndex >= commandUsages.size() || commandUsageGenerations[command.usageIndex] != command.usageGeneration)
+            return;
+
+        std::string().swap(commandUsages[command.usageIndex]);
+        ++commandUsageGenerations[command.usageIndex]; // copies of the command do not see the next usage put in it
+        freeCommandUsages.push_back(command.usageIndex);
+    }
+
+    /// @return false if name is not valid, prints an error if it already exists
+    static bool checkCommandName(const std::string& name) {
+        if (!Utils::isValidName(name)) {
+            printInvalidName(name);
+            return false;
+        }
+
+        Command* pCommand = nullptr;
+        if (Command::getCommand(name, pCommand, false))
+            printf(OutputLevel::_ERROR, "command with name \"{}\" already exists\n", name);
+
+        return true;
+    }
+
     void registerCommand(const std::string& name, unsigned char minArgs, unsigned char maxArgs,
             CommandCallback callback, const std::string& usage, void* pData) {
-        Command::commands.emplace_back(name, minArgs, maxArgs, callback, usage, pData);
+        if (!checkCommandName(name))
+            return;
+
+        Command command; // not the constructor, which would keep the usage in pPendingUsage first
+        command.callback = callback;
+        command.pData = pData;
+        command.minArgs = minArgs;
+        command.maxArgs = maxArgs;
+        command.name = name;
+
+        Command::commands.push_back(std::move(command));
+        storeUsage(Command::commands.back(), usage);
+        indexLastCommand();
     }
 
     void registerCommand(const Command& command) {
+        if (!checkCommandName(command.name))
+            return;
+
+        std::string usage = command.getUsage(); // command could be in Command::commands, which is about to grow
         Command::commands.push_back(command);
+        storeUsage(Command::commands.back(), usage);
+        indexLastCommand();
     }
 
-    Command::Command(const std::string& name, unsigned char minArgs, unsigned char maxArgs, CommandCallback callback, const std::string& usage, void* pData)
-      : name(name), usage(usage), minArgs(minArgs), maxArgs(maxArgs), callback(callback), pData(pData) {
-        for (const auto& c : commands) {
-            if (c.name == name) {
-                printf(OutputLevel::_ERROR, "command with name \"{}\" already exists\n", name);
-                return;
+    void _registerCommandTable(const CommandDefinition* pDefinitions, size_t count, void* pData, const void* pTable, long (*find)(const void* pTable, const std::string& name)) {
+        // the table can only be used to find its commands if all of them end up in it, in order, and none existed before
+        std::vector<char> valid(count, true);
+        bool usable = true;
+        for (size_t i = 0; i < count; ++i) {
+            if (!Utils::isValidName(pDefinitions[i].name)) {
+                printInvalidName(pDefinitions[i].name);
+                valid[i] = false;
+                usable = false;
+                continue;
+            }
+
+            Command* pExisting = nullptr;
+            if (Command::getCommand(pDefinitions[i].name, pExisting, false)) {
+                printf(OutputLevel::_ERROR, "command with name \"{}\" already exists\n", pDefinitions[i].name);
+                usable = false;
             }
         }
+
+        // entries are not given a usage slot, their usage stays in the table until it is asked for
+        reserveCommands(count);
+        size_t first = Command::commands.size();
+        for (size_t i = 0; i < count; ++i) {
+            if (!valid[i])
+                continue;
+
+            Command command;
+            command.callback = pDefinitions[i].callback;
+            command.pData = pData;
+            command.minArgs = pDefinitions[i].minArgs;
+            command.maxArgs = pDefinitions[i].maxArgs;
+            command.name = pDefinitions[i].name;
+            command.pTableUsage = pDefinitions[i].usage;
+            Command::commands.push_back(std::move(command));
+        }
+
+        // a table that can not be used has its commands put in commandIndex like any other, on the next lookup
+        bool indexed = indexedCommandCount == first;
+        if (usable)
+            commandTables.push_back({pTable, find, first, count});
+        indexedCommandCount = usable && indexed ? Command::commands.size() : static_cast<size_t>(-1);
     }
 
+    Command::Command(const std::string& name, unsigned char minArgs, unsigned char maxArgs, CommandCallback callback, const std::string& usage, void* pData)
+      : callback(callback), pData(pData), minArgs(minArgs), maxArgs(maxArgs), name(name), pPendingUsage(std::make_shared<const std::string>(usage)) {}
+
     bool Command::getCommand(const std::string& name, Command*& pCommandOut, bool printError) {
-        for (auto& command : commands)
-            if (command.name == name) {
-                pCommandOut = &command;
+        for (const auto& table : commandTables) {
+            long i = table.find(table.pTable, name);
+            if (i >= 0 && table.first + i < commands.size() && commands[table.first + i].name == name) {
+                pCommandOut = &commands[table.first + i];
                 return true;
             }
+        }
+
+        updateCommandIndex();
+        auto it = commandIndex.find(name);
+        if (it != commandIndex.end()) {
+            pCommandOut = &commands[it->second];
+            return true;
+        }
 
         if (printError)
             printUnknownCommand(name);
@@ -123,7 +556,19 @@ namespace SweatCI {
     bool Command::deleteCommand(const std::string& commandName) {
         for (size_t i = 0; i < commands.size(); ++i)
             if (commands[i].name == commandName) {
+                freeUsage(commands[i]);
                 commands.erase(commands.begin() + i);
+                indexedCommandCount = static_cast<size_t>(-1);
+                ++commandsRemoved;
+
+                // tables after it move back one, the one it was in can not be used anymore
+                for (size_t j = commandTables.size(); j-- > 0;) {
+                    if (i < commandTables[j].first)
+                        --commandTables[j].first;
+                    else if (i < commandTables[j].first + commandTables[j].count)
+                        commandTables.erase(commandTables.begin() + j);
+                }
+
                 return true;
             }
 
@@ -135,32 +580,241 @@ namespace SweatCI {
     }
 
     void Command::printUsage(const Command &command) {
-        print(OutputLevel::WARNING, command.name + ' ' + command.usage + '\n');
+        print(OutputLevel::WARNING, command.name + ' ' + command.getUsage() + '\n');
+    }
+
+    const std::string& Command::getUsage() const {
+        static const std::string empty;
+        if (pPendingUsage)
+            return *pPendingUsage;
+
+        if (usageIndex < commandUsages.size() && commandUsageGenerations[usageIndex] == usageGeneration)
+            return commandUsages[usageIndex];
+
+        if (pTableUsage != nullptr) {
+            std::string& usage = commandTableUsages[pTableUsage];
+            if (usage.empty())
+                usage = pTableUsage;
+
+            return usage;
+        }
+
+        return empty;
     }
 
     void Command::clear() {
         commands.clear();
+        commandUsages.clear();
+        commandUsageGenerations.clear();
+        freeCommandUsages.clear();
+        ++commandsRemoved;
+        commandTables.clear();
+        commandIndex.clear();
+        indexedCommandCount = 0;
     }
 
     void Command::run(CommandContext& ctx) {
+        TraceScope trace("command", name, &ctx);
         ctx.pCommand = this;
+        ++runCount;
 
         callback(ctx);
     }
 
+    unsigned long long Command::getRunCount() {
+        return runCount;
+    }
+
     std::vector<Command> Command::commands;
+    unsigned long long Command::runCount = 0;
+
+    struct TraceEvent {
+        char phase = 'B'; // 'B' for begin and 'E' for end
+        const char* category = "";
+        const std::string* pName = nullptr; // in TraceBuffer::names, nullptr if empty
+        const std::string* pFilePath = nullptr; // same
+        size_t lineIndex = 0;
+        unsigned long long timestamp = 0; // nanoseconds since Tracer::start
+    };
+
+    struct TraceBuffer {
+        std::vector<TraceEvent> events;
+        std::atomic<size_t> count{0}; // every event written, including the ones overwritten
+        size_t threadId = 0;
+        std::unordered_set<std::string> names; // every name and file path the events point to, each one is copied once
+    };
+
+    /*
+     * Buffers are shared by traceBuffers and the thread writing into them, so Tracer::start can drop them while
+     * a thread is still writing its last event, the thread only takes a new buffer when it sees the new session.
+     */
+    static std::mutex traceBuffersMutex;
+    static std::vector<std::shared_ptr<TraceBuffer>> traceBuffers;
+    static size_t traceCapacity = 65536;
+    static std::atomic<unsigned int> traceSession{0};
+    static std::chrono::steady_clock::time_point traceStart = std::chrono::steady_clock::now();
+
+    std::atomic<bool> Tracer::enabled{false};
+
+    static TraceBuffer* getTraceBuffer() {
+        thread_local std::shared_ptr<TraceBuffer> pBuffer;
+        thread_local unsigned int bufferSession = 0;
+
+        // buffers from a previous session were dropped by Tracer::start
+        unsigned int session = traceSession.load(std::memory_order_acquire);
+        if (pBuffer == nullptr || bufferSession != session) {
+            std::lock_guard<std::mutex> lock(traceBuffersMutex);
+
+            pBuffer = std::make_shared<TraceBuffer>();
+            pBuffer->events.resize(traceCapacity);
+            traceBuffers.push_back(pBuffer);
+            pBuffer->threadId = traceBuffers.size();
+            bufferSession = traceSession.load(std::memory_order_relaxed); // start can not run while the lock is held
+        }
+
+        return pBuffer.get();
+    }
+
+    /// @return the copy of name kept by pBuffer, nullptr if name is empty
+    static const std::string* internTraceName(TraceBuffer* pBuffer, const std::string& name) {
+        if (name.empty())
+            return nullptr;
+
+        return &*pBuffer->names.insert(name).first;
+    }
+
+    static void recordTraceEvent(char phase, const char* category, const std::string* pName, const CommandContext* pCtx) {
+        TraceBuffer* pBuffer = getTraceBuffer();
+
+        size_t count = pBuffer->count.load(std::memory_order_relaxed);
+        TraceEvent& event = pBuffer->events[count % pBuffer->events.size()];
+
+        event.phase = phase;
+        event.category = category;
+        event.pName = pName == nullptr? nullptr : internTraceName(pBuffer, *pName);
+        event.pFilePath = pCtx == nullptr? nullptr : internTraceName(pBuffer, pCtx->filePath);
+        event.lineIndex = pCtx == nullptr? 0 : pCtx->lineIndex;
+        event.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceStart).count();
+
+        pBuffer->count.store(count + 1, std::memory_order_release);
+    }
+
+    void Tracer::start(size_t capacity) {
+        {
+            std::lock_guard<std::mutex> lock(traceBuffersMutex);
+            traceBuffers.clear(); // threads still writing into them keep them until their next event
+            traceCapacity = capacity == 0? 1 : capacity;
+            traceStart = std::chrono::steady_clock::now();
+            traceSession.fetch_add(1, std::memory_order_release);
+        }
+
+        enabled.store(true, std::memory_order_relaxed);
+    }
+
+    void Tracer::stop() {
+        enabled.store(false, std::memory_order_relaxed);
+    }
+
+    void Tracer::begin(const char* category, const std::string& name, const CommandContext* pCtx) {
+        if (isEnabled())
+            recordTraceEvent('B', category, &name, pCtx);
+    }
+
+    void Tracer::end(const char* category) {
+        if (isEnabled())
+            recordTraceEvent('E', category, nullptr, nullptr);
+    }
+
+    static std::string escapeJson(const std::string& str) {
+        static const char* hex = "0123456789abcdef";
+
+        std::string out;
+        for (const auto& c : str) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                out += "\\u00";
+                out += hex[c >> 4];
+                out += hex[c & 0xf];
+            } else
+                out += c;
+        }
+
+        return out;
+    }
+
+    void Tracer::exportChromeTrace(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(traceBuffersMutex);
+
+        out << "{\"traceEvents\":[";
+        bool first = true;
+
+        for (const auto& pBuffer : traceBuffers) {
+            size_t count = pBuffer->count.load(std::memory_order_acquire);
+            size_t size = pBuffer->events.size();
+
+            for (size_t i = count > size? count - size : 0; i < count; ++i) {
+                const TraceEvent& event = pBuffer->events[i % size];
+
+                std::string nanoseconds = std::to_string(event.timestamp % 1000);
+                out << (first? "\n" : ",\n")
+                    << "{\"ph\":\"" << event.phase << "\",\"cat\":\"" << event.category
+                    << "\",\"ts\":" << event.timestamp / 1000 << '.' << std::string(3 - nanoseconds.size(), '0') << nanoseconds
+                    << ",\"pid\":1,\"tid\":" << pBuffer->threadId;
+
+                if (event.phase == 'B') {
+                    out << ",\"name\":\"" << (event.pName == nullptr? "" : escapeJson(*event.pName)) << '"';
+                    if (event.pFilePath != nullptr)
+                        out << ",\"args\":{\"file\":\"" << escapeJson(*event.pFilePath) << "\",\"line\":" << event.lineIndex + 1 << '}';
+                }
+
+                out << '}';
+                first = false;
+            }
+        }
+
+        out << "\n]}\n";
+    }
+
+    bool Tracer::exportChromeTrace(const std::string& path) {
+        std::ofstream file(path);
+        if (!file)
+            return false;
+
+        exportChromeTrace(file);
+        return true;
+    }
+
+    TraceScope::TraceScope(const char* category, const std::string& name, const CommandContext* pCtx) : category(category), active(Tracer::isEnabled()) {
+        if (active)
+            Tracer::begin(category, name, pCtx);
+    }
+
+    TraceScope::~TraceScope() {
+        if (active)
+            Tracer::end(category);
+    }
+
+    static constexpr CommandDefinition baseCommands[] = {
+        {"help", 0, 1, BaseCommands::help, "<command> - shows the usage of the command specified"},
+        {"commands", 0, 0, BaseCommands::commands, "- shows a list of commands with their usages"},
+        {"echo", 1, 1, BaseCommands::echo, "<message> - echoes a message to the console"},
+        {"alias", 1, 2, BaseCommands::alias, "<var> <commands?> - creates/deletes variables"},
+        {"variables", 0, 0, BaseCommands::getVariables, "- list of variables"},
+        {"variable", 1, 1, BaseCommands::variable, "- shows variable value"},
+        {"incrementvar", 4, 4, BaseCommands::incrementvar, "<var|cvar> <minValue> <maxValue> <delta> - increments the value of a variable"},
+        {"exec", 1, 1, BaseCommands::exec, "- executes a .cfg file that contains SweatCI script"},
+        {"toggle", 3, 3, BaseCommands::toggle, "<var|cvar> <option1> <option2> - toggles value between option1 and option2"},
+        {"wait", 0, 1, BaseCommands::wait, "<frames?> - stops the script and continues it after the amount of frames(1 by default)"},
+        {"after", 2, 2, BaseCommands::after, "<milliseconds> <commands> - runs the commands after the amount of milliseconds"},
+        {"mem_stats", 0, 1, BaseCommands::memStats, "<reset?> - shows how much memory each part of the interpreter holds, \"reset\" resets the peaks"}
+    };
+
+    static constexpr CommandTable<sizeof(baseCommands) / sizeof(baseCommands[0])> baseCommandTable(baseCommands);
 
     void BaseCommands::init(std::unordered_map<std::string, std::string>* pVariables) {
-        // Add commands
-        registerCommand("help", 0, 1, help, "<command> - shows the usage of the command specified");
-        registerCommand("commands", 0, 0, commands, "- shows a list of commands with their usages");
-        registerCommand("echo", 1, 1, echo, "<message> - echoes a message to the console");
-        registerCommand("alias", 1, 2, alias, "<var> <commands?> - creates/deletes variables", pVariables);
-        registerCommand("variables", 0, 0, getVariables, "- list of variables", pVariables);
-        registerCommand("variable", 1, 1, variable, "- shows variable value", pVariables);
-        registerCommand("incrementvar", 4, 4, incrementvar, "<var|cvar> <minValue> <maxValue> <delta> - increments the value of a variable", pVariables);
-        registerCommand("exec", 1, 1, exec, "- executes a .cfg file that contains SweatCI script", pVariables);
-        registerCommand("toggle", 3, 3, toggle, "<var|cvar> <option1> <option2> - toggles value between option1 and option2", pVariables);
+        registerCommands(baseCommandTable, pVariables);
     }
 
     void BaseCommands::help(CommandContext& ctx) {
@@ -170,13 +824,13 @@ namespace SweatCI {
             if (Command::getCommand(ctx.args[0], pCommand, true))
                 Command::printUsage(*pCommand);
         } else
-            printf(OutputLevel::WARNING, "{} {} - see \"commands\" command to get a list of commands\n", ctx.pCommand->name, ctx.pCommand->usage);
+            printf(OutputLevel::WARNING, "{} {} - see \"commands\" command to get a list of commands\n", ctx.pCommand->name, ctx.pCommand->getUsage());
     }
 
     void BaseCommands::commands(CommandContext&) {
         std::stringstream out;
         for (auto& command : Command::getCommands())
-            out << command.name << " " << command.usage << "\n";
+            out << command.name << " " << command.getUsage() << "\n";
 
         print(OutputLevel::ECHO, out.str());
     }
@@ -200,6 +854,8 @@ namespace SweatCI {
             }
 
             pVariables->erase(ctx.args[0]);
+            AliasGraph::removeAlias(ctx.args[0]);
+
             if (ctx.args[0].front() == '!') {
                 auto it = std::find(loopAliasesRunning.begin(), loopAliasesRunning.end(), ctx.args[0]);
                 if (it != loopAliasesRunning.end())
@@ -223,18 +879,19 @@ namespace SweatCI {
             }
         }
 
-        std::regex whitespace_regex("\\S+"); // TODO: regex is unecessary here I think(use old ways to do this instead of using regex)
-        if (!std::regex_match(ctx.args[0], whitespace_regex)) {
-            print(OutputLevel::_ERROR, "variable name can not have whitespace.\n");
+        if (!Utils::isValidName(ctx.args[0])) {
+            printInvalidName(ctx.args[0]);
             return;
         }
 
         std::string negativeVarName = '-'+ctx.args[0].substr(1);
         if (ctx.args[0].front() == '+' && pVariables->count(negativeVarName) == 0) {
             (*pVariables)[negativeVarName] = " ";
+            AliasGraph::setAlias(negativeVarName, " ");
         }
 
         (*pVariables)[ctx.args[0]] = ctx.args[1];
+        AliasGraph::setAlias(ctx.args[0], ctx.args[1]);
     }
 
     void BaseCommands::getVariables(CommandContext& ctx) {
@@ -292,7 +949,7 @@ namespace SweatCI {
                 else if (variableValue < minValue)
                     variableValue = maxValue;
                 
-                pCvar->set(pCvarCommand->pData, numberToString(variableValue));
+                CVARStorage::setValue(ctx.args[0], *pCvar, pCvarCommand->pData, numberToString(variableValue));
 
                 return;
             }
@@ -317,6 +974,7 @@ namespace SweatCI {
             variableValue = maxValue;
 
         it->second = numberToString(variableValue);
+        AliasGraph::setAlias(it->first, it->second);
     }
 
     void BaseCommands::exec(CommandContext& ctx) {
@@ -334,9 +992,9 @@ namespace SweatCI {
                 std::string asString = pCvar->toString(pCvarCommand->pData);
 
                 if (asString == ctx.args[1])
-                    pCvar->set(pCvarCommand->pData, ctx.args[2]);
+                    CVARStorage::setValue(ctx.args[0], *pCvar, pCvarCommand->pData, ctx.args[2]);
                 else
-                    pCvar->set(pCvarCommand->pData, ctx.args[1]);
+                    CVARStorage::setValue(ctx.args[0], *pCvar, pCvarCommand->pData, ctx.args[1]);
 
                 return;
             }
@@ -353,93 +1011,270 @@ namespace SweatCI {
             it->second = ctx.args[2];
         else
             it->second = ctx.args[1];
+
+        AliasGraph::setAlias(it->first, it->second);
     }
 
-    Lexer::Lexer(const CommandContext& ctx, const std::string& input) : ctx(ctx), input(input) {}
+    void BaseCommands::wait(CommandContext& ctx) {
+        unsigned int frames = 1;
+        if (ctx.args.size() == 1 && !Utils::Command::getUnsignedInteger(ctx.args[0], frames))
+            return;
 
-    bool Lexer::nextPosition() {
-        ++position;
-        ++ctx.columnIndex;
+        Scheduler::requestWait(frames == 0? 1 : frames);
+    }
 
-        if (input[position] == '\n') {
-            ++ctx.lineIndex;
-            ctx.columnIndex = 0;
-            return true;
-        }
+    void BaseCommands::after(CommandContext& ctx) {
+        unsigned int milliseconds;
+        if (!Utils::Command::getUnsignedInteger(ctx.args[0], milliseconds))
+            return;
 
-        return false;
+        CommandContext taskCtx = ctx;
+        taskCtx.args.clear();
+        taskCtx.pCommand = nullptr;
+
+        ParserState state;
+        state.lexers.emplace_back(taskCtx, ctx.args[1]);
+        Scheduler::waitMilliseconds(std::move(state), milliseconds);
     }
 
-    Token Lexer::nextToken() {
-        if (position >= input.length()) {
-            lastToken = {TokenType::_EOF, ""};
-            return lastToken;
+    void BaseCommands::memStats(CommandContext& ctx) {
+        if (ctx.args.size() == 1 && ctx.args[0] != "reset") {
+            Command::printUsage(*ctx.pCommand);
+            return;
         }
 
-        char currentChar = input[position];
-        if (currentChar == '\n') {
-            ++position;
-            lastToken = Token(TokenType::EOS, "\n");
-            return lastToken;
-        }
+        Memory::measure(static_cast<std::unordered_map<std::string, std::string>*>(ctx.pCommand->pData));
+        if (ctx.args.size() == 1)
+            Memory::resetPeaks();
 
-        while (std::isspace(currentChar)) {
-            if (nextPosition()) {
-                lastToken = Token(TokenType::EOS, "\n");
-                return lastToken;
-            }
+        std::stringstream out;
+        auto printUsage = [&out](const char* name, const MemoryUsage& usage) {
+            out << name << ": " << usage.count << " items, " << usage.bytes << " bytes in " << usage.allocations
+                << " allocations, peak " << usage.peakBytes << " bytes in " << usage.peakAllocations << " allocations\n";
+        };
 
-            if (position >= input.length()) {
-                lastToken = Token(TokenType::_EOF, "");
-                return lastToken;
-            }
+        for (unsigned char i = 0; i < MEMORY_SUBSYSTEM_COUNT; ++i)
+            printUsage(Memory::getName(static_cast<MemorySubsystem>(i)), Memory::getUsage(static_cast<MemorySubsystem>(i)));
+        printUsage("total", Memory::getTotal());
 
-            currentChar = input[position];
+        print(OutputLevel::ECHO, out.str());
+    }
+
+    /*
+     * The lexer and the comment stripper only have work to do at a few characters, a scan finds the next one of them
+     * so everything in between is copied at once. With SSE2, 16 characters are classified at a time, anything else
+     * (and the tail of the input) goes one character at a time.
+     * A scanner is a struct with isStructural(char) and, with SSE2, structural(__m128i) returning 0xFF for the ones it stops at.
+     */
+
+    /// @brief what may start or end a comment, a quote or a line for stripComments
+    struct CommentCharacters {
+        static bool isStructural(unsigned char c) {
+            return c == '"' || c == '/' || c == '*' || c == '\n';
         }
 
-        if ((input[position] == ';' || input[position] == '\n') && (position == 0 || input[position-1] != '\\')) {
-            nextPosition();
-            lastToken = Token(TokenType::EOS, ";");
-            return lastToken;
+#ifdef SWEATCI_SSE2
+        static __m128i structural(__m128i chunk) {
+            __m128i quotes = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'));
+            __m128i slashes = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('/'));
+            __m128i stars = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('*'));
+            __m128i newlines = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'));
+            return _mm_or_si128(_mm_or_si128(quotes, slashes), _mm_or_si128(stars, newlines));
         }
+#endif
+    };
 
-        lastToken = parseToken();
-        return lastToken;
-    }
+    /// @brief what may end a token outside quotes: ';' and anything up to ' ', Lexer::parseToken decides which really do
+    struct TokenCharacters {
+        static bool isStructural(unsigned char c) {
+            return c <= ' ' || c == ';';
+        }
 
-    bool Lexer::isCommand(const std::string& commandName) {
-        for (const auto& command : Command::getCommands()) {
-            if (command.name == commandName)
-                return true;
+#ifdef SWEATCI_SSE2
+        static __m128i structural(__m128i chunk) {
+            __m128i controls = _mm_cmpeq_epi8(_mm_max_epu8(chunk, _mm_set1_epi8(' ')), _mm_set1_epi8(' '));
+            return _mm_or_si128(controls, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(';')));
         }
+#endif
+    };
 
-        return false;
-    }
+    /// @brief what Lexer::parseString handles itself: the closing quote, escapes and newlines
+    struct StringCharacters {
+        static bool isStructural(unsigned char c) {
+            return c == '"' || c == '\\' || c == '\n';
+        }
 
-    Token Lexer::parseToken() {
-        if (input[position] == '"')
-            return parseString();
+#ifdef SWEATCI_SSE2
+        static __m128i structural(__m128i chunk) {
+            __m128i quotes = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'));
+            __m128i backslashes = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'));
+            __m128i newlines = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'));
+            return _mm_or_si128(_mm_or_si128(quotes, backslashes), newlines);
+        }
+#endif
+    };
+
+#ifdef SWEATCI_SSE2
+    static size_t firstBit(unsigned int mask) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+#endif
+
+    /// @return index of the first structural character in [position, end), end if there is none
+    template<typename Characters>
+    static size_t findStructural(const std::string& input, size_t position, size_t end) {
+        const char* data = input.data();
+
+#ifdef SWEATCI_SSE2
+        for (; position + 16 <= end; position += 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+            unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(Characters::structural(chunk)));
+            if (mask != 0)
+                return position + firstBit(mask);
+        }
+#endif
 
-        std::string tokenValue;
-        while (position < input.length() && !std::isspace(input[position]) && input[position] != ';' && input[position] != '\n') {
-            tokenValue += input[position];
+        for (; position < end; ++position)
+            if (Characters::isStructural(static_cast<unsigned char>(data[position])))
+                return position;
+
+        return end;
+    }
+
+    Lexer::Lexer(const CommandContext& ctx, const std::string& input) : ctx(ctx), input(input), memory(Memory::getHeapBytes(this->input)) {}
+
+    const std::string& Lexer::getInput() const {
+        return input;
+    }
+
+    void Lexer::reset(const CommandContext& ctx, const char* pInput, size_t size) {
+        this->ctx = ctx;
+        input.assign(pInput, size);
+        memory.resize(Memory::getHeapBytes(input));
+        position = 0;
+        lastTokenType = TokenType::NOTHING;
+    }
+
+    bool Lexer::nextPosition() {
+        ++position;
+        ++ctx.columnIndex;
+
+        if (input[position] == '\n') {
+            ++ctx.lineIndex;
+            ctx.columnIndex = 0;
+            return true;
+        }
+
+        return false;
+    }
+
+    void Lexer::skipTo(size_t newPosition) {
+        if (newPosition == position)
+            return;
+
+        ctx.columnIndex += newPosition - position;
+        position = newPosition;
+
+        if (input[position] == '\n') {
+            ++ctx.lineIndex;
+            ctx.columnIndex = 0;
+        }
+    }
+
+    Token Lexer::nextToken() {
+        Token token;
+        nextToken(token);
+        return token;
+    }
+
+    void Lexer::nextToken(Token& tokenOut) {
+        if (position >= input.length()) {
+            lastTokenType = TokenType::_EOF;
+            tokenOut.set(TokenType::_EOF, "", 0);
+            return;
+        }
+
+        char currentChar = input[position];
+        if (currentChar == '\n') {
+            ++position;
+            lastTokenType = TokenType::EOS;
+            tokenOut.set(TokenType::EOS, "\n", 1);
+            return;
+        }
+
+        while (std::isspace(currentChar)) {
+            if (nextPosition()) {
+                lastTokenType = TokenType::EOS;
+                tokenOut.set(TokenType::EOS, "\n", 1);
+                return;
+            }
+
+            if (position >= input.length()) {
+                lastTokenType = TokenType::_EOF;
+                tokenOut.set(TokenType::_EOF, "", 0);
+                return;
+            }
+
+            currentChar = input[position];
+        }
+
+        if ((input[position] == ';' || input[position] == '\n') && (position == 0 || input[position-1] != '\\')) {
             nextPosition();
+            lastTokenType = TokenType::EOS;
+            tokenOut.set(TokenType::EOS, ";", 1);
+            return;
+        }
+
+        parseToken(tokenOut);
+        lastTokenType = tokenOut.getType();
+    }
+
+    bool Lexer::isCommand(const std::string& commandName) {
+        Command* pCommand = nullptr;
+        return Command::getCommand(commandName, pCommand, false);
+    }
+
+    void Lexer::parseToken(Token& tokenOut) {
+        if (input[position] == '"') {
+            parseString(tokenOut);
+            return;
         }
 
+        // "\;" is part of the token, nextToken does not treat it as the end of the statement
+        size_t start = position;
+        size_t end = findStructural<TokenCharacters>(input, position, input.length());
+        while (end < input.length() && !std::isspace(input[end]) && (input[end] != ';' || (end != 0 && input[end-1] == '\\')) && input[end] != '\n')
+            end = findStructural<TokenCharacters>(input, end + 1, input.length());
+
+        skipTo(end);
+        tokenOut.set(TokenType::STRING, input.data() + start, end - start);
+
 		// TODO: wtf is that "x == Nothing || x != Command"????? Why not just "x != Command"???
-        if (isCommand(tokenValue) && (lastToken.getType() == TokenType::NOTHING || lastToken.getType() != TokenType::COMMAND))
-            return Token(TokenType::COMMAND, tokenValue);
-        else
-            return Token(TokenType::STRING, tokenValue);
+        if (isCommand(tokenOut.value) && (lastTokenType == TokenType::NOTHING || lastTokenType != TokenType::COMMAND))
+            tokenOut.type = TokenType::COMMAND;
     }
 
-    Token Lexer::parseString() {
-        std::string tokenValue = "";
+    void Lexer::parseString(Token& tokenOut) {
+        tokenOut.set(TokenType::STRING, "", 0);
+        std::string& tokenValue = tokenOut.value;
 
         ++position; // Skip the first double quote
         ++ctx.columnIndex;
 
         while (position < input.length() && input[position] != '"') {
+            size_t next = findStructural<StringCharacters>(input, position, input.length());
+            if (next != position) {
+                tokenValue.append(input, position, next - position);
+                skipTo(next);
+                continue;
+            }
+
             // escape '\\'
             if (input[position] == '\\' && position + 1 < input.length() && input[position+1] == '\\')
                 nextPosition();
@@ -454,8 +1289,28 @@ namespace SweatCI {
 
         if (input[position] == '"')
             nextPosition(); // Skip the last double quote if exists
+    }
+
+    struct NameCharacters {
+        bool valid[256];
+
+        constexpr NameCharacters() : valid() {
+            for (int c = 0; c < 256; ++c)
+                valid[c] = c > ' ' && c != 127 && c != ';' && c != '"';
+        }
+    };
+
+    static constexpr NameCharacters nameCharacters{};
 
-        return Token(TokenType::STRING, tokenValue);
+    bool Utils::isValidName(const std::string& name) {
+        if (name.empty())
+            return false;
+
+        for (const auto& c : name)
+            if (!nameCharacters.valid[static_cast<unsigned char>(c)])
+                return false;
+
+        return true;
     }
 
     void Utils::Cvar::setString(void* pData, const std::string& value) {
@@ -498,43 +1353,40 @@ namespace SweatCI {
     
     _MAKE_CVARUTILS_NUMBER_FUNCTIONS(unsigned char, (unsigned char)std::stoi, UnsignedChar)
 
-#define _MAKE_CVARUTILS_BIT_FUNCTIONS(type, bit, power, convertFunc, name) \
+    // BitN is bit index N-1
+#define _MAKE_CVARUTILS_BIT_FUNCTIONS(type, bit, name) \
     void Utils::Cvar:: setBit ## bit ## name (void* pData, const std::string& value) { \
-        try { \
-            type number = convertFunc(value); \
-            if (number > 0) *static_cast<type*>(pData) |= power; \
-            else *static_cast<type*>(pData) &= ~bit; \
-        } catch (...) {return;} \
+        setBit<type, bit-1>(pData, value); \
     } \
     std::string Utils::Cvar:: getBit ## bit ## name (void* pData) { \
-        return std::to_string(((*static_cast<type*>(pData)) & power) == power); \
-    }
-
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 1,1, (unsigned char)std::stoi, UnsignedChar)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 2,2, (unsigned char)std::stoi, UnsignedChar)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 3,4, (unsigned char)std::stoi, UnsignedChar)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 4,8, (unsigned char)std::stoi, UnsignedChar)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 5,16, (unsigned char)std::stoi, UnsignedChar)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 6,32, (unsigned char)std::stoi, UnsignedChar)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 7,64, (unsigned char)std::stoi, UnsignedChar)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 8,128, (unsigned char)std::stoi, UnsignedChar)
-
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 1,1, (unsigned short)std::stoi, UnsignedShort)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 2,2, (unsigned short)std::stoi, UnsignedShort)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 3,4, (unsigned short)std::stoi, UnsignedShort)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 4,8, (unsigned short)std::stoi, UnsignedShort)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 5,16, (unsigned short)std::stoi, UnsignedShort)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 6,32, (unsigned short)std::stoi, UnsignedShort)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 7,64, (unsigned short)std::stoi, UnsignedShort)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 8,128, (unsigned short)std::stoi, UnsignedShort)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 9,256, (unsigned short)std::stoi, UnsignedShort)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 10,512, (unsigned short)std::stoi, UnsignedShort)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 11,1024, (unsigned short)std::stoi, UnsignedShort)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 12,2048, (unsigned short)std::stoi, UnsignedShort)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 13,4096, (unsigned short)std::stoi, UnsignedShort)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 14,8192, (unsigned short)std::stoi, UnsignedShort)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 15,16384, (unsigned short)std::stoi, UnsignedShort)
-    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 16,32768, (unsigned short)std::stoi, UnsignedShort)
+        return getBit<type, bit-1>(pData); \
+    }
+
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 1, UnsignedChar)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 2, UnsignedChar)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 3, UnsignedChar)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 4, UnsignedChar)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 5, UnsignedChar)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 6, UnsignedChar)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 7, UnsignedChar)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned char, 8, UnsignedChar)
+
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 1, UnsignedShort)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 2, UnsignedShort)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 3, UnsignedShort)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 4, UnsignedShort)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 5, UnsignedShort)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 6, UnsignedShort)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 7, UnsignedShort)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 8, UnsignedShort)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 9, UnsignedShort)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 10, UnsignedShort)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 11, UnsignedShort)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 12, UnsignedShort)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 13, UnsignedShort)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 14, UnsignedShort)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 15, UnsignedShort)
+    _MAKE_CVARUTILS_BIT_FUNCTIONS(unsigned short, 16, UnsignedShort)
 
     bool Utils::Command::getBoolean(const std::string& str, bool& out) {
         try {
@@ -571,16 +1423,65 @@ namespace SweatCI {
 
     _MAKE_COMMANDUTILS_FUNCTIONS(unsigned char, std::stoi, UnsignedChar)
 
-    void CVARStorage::setCvar(const std::string& name, void* pData, void(*set)(void* pData, const std::string& value), std::string (*toString)(void* pData), const std::string& usage) {
-        cvars[name] = {set, toString};
+    /// @brief reads everything left in the stream, in blocks instead of line by line
+    static std::string readStream(std::istream& stream) {
+        std::string content;
+        char buffer[65536];
+        while (stream.read(buffer, sizeof(buffer)) || stream.gcount() > 0)
+            content.append(buffer, static_cast<size_t>(stream.gcount()));
+
+        return content;
+    }
+
+    void CVARStorage::setCvar(const std::string& name, void* pData, void(*set)(void* pData, const std::string& value), std::string (*toString)(void* pData), const std::string& usage, unsigned char flags) {
+        if (!Utils::isValidName(name)) {
+            printInvalidName(name);
+            return;
+        }
+
+        CVariable& cvar = cvars[name];
+        if ((cvar.flags & ARCHIVE) != (flags & ARCHIVE)) {
+            if (flags & ARCHIVE)
+                ++archivedCount;
+            else
+                --archivedCount;
+        }
+
+        cvar.set = set;
+        cvar.toString = toString;
+        cvar.pData = pData;
+        cvar.flags = flags;
+        cvar.clamp = false;
+
         registerCommand(name, 0, 1, asCommand, usage, pData);
     }
 
+    void CVARStorage::setCvar(const std::string& name, void* pData, void(*set)(void* pData, const std::string& value), std::string (*toString)(void* pData), const std::string& usage, unsigned char flags, double minValue, double maxValue) {
+        setCvar(name, pData, set, toString, usage, flags);
+
+        CVariable* pCvar = nullptr;
+        if (!getCvar(name, pCvar))
+            return;
+
+        pCvar->clamp = true;
+        pCvar->minValue = minValue;
+        pCvar->maxValue = maxValue;
+    }
+
+    void CVARStorage::setCvars(const CvarDefinition* pDefinitions, size_t count) {
+        cvars.reserve(cvars.size() + count);
+        reserveCommands(count);
+
+        for (size_t i = 0; i < count; ++i)
+            setCvar(pDefinitions[i].name, pDefinitions[i].pData, pDefinitions[i].set, pDefinitions[i].toString, pDefinitions[i].usage, pDefinitions[i].flags);
+    }
+
     bool CVARStorage::getCvar(const std::string& name, CVariable*& pBuf) {
-        if (cvars.count(name) == 0)
+        auto it = cvars.find(name);
+        if (it == cvars.end())
             return false;
 
-        pBuf = &cvars[name];
+        pBuf = &it->second;
         return true;
     }
 
@@ -599,345 +1500,2021 @@ namespace SweatCI {
 
         // if should set value
         try {
-            pCvar->set(ctx.pCommand->pData, ctx.args[0]);
+            setValue(ctx.pCommand->name, *pCvar, ctx.pCommand->pData, ctx.args[0]);
         } catch (...) {
             Command::printUsage(*ctx.pCommand);
         }
     }
 
-    std::unordered_map<std::string, CVariable> CVARStorage::cvars;
-
-    std::vector<std::string> loopAliasesRunning = {};
-    std::vector<std::string> toggleTypesRunning = {};
+    bool CVARStorage::setValue(const std::string& name, CVariable& cvar, void* pData, const std::string& value) {
+        if (cvar.flags & READ_ONLY) {
+            printf(OutputLevel::_ERROR, "\"{}\" is read-only\n", name);
+            return false;
+        }
 
-    void handleLoopAliasesRunning(std::unordered_map<std::string, std::string>* pVariables) {
-        for (auto& loopAlias : loopAliasesRunning) {
-            Lexer lexer{ { .runningFrom = ALIAS|LOOP_ALIAS|INTERNAL }, pVariables->at(loopAlias)};
-            Parser(&lexer, pVariables).parse();
+        if ((cvar.flags & CHEAT) && !cheatsEnabled) {
+            printf(OutputLevel::_ERROR, "\"{}\" can only be set with cheats enabled\n", name);
+            return false;
         }
-    }
 
-    Parser::Parser(Lexer* pLexer, std::unordered_map<std::string, std::string>* pVariables) : pLexer(pLexer), pVariables(pVariables) {
-        advance();
+        return applyValue(name, cvar, pData, value, false);
     }
 
-    void Parser::advance() {
-        currentToken = pLexer->nextToken();
+    /// @return false if value is not one number, spaces around it are allowed
+    static bool isWholeNumber(const std::string& value) {
+        char* pEnd = nullptr;
+        std::strtod(value.c_str(), &pEnd);
+        if (pEnd == value.c_str())
+            return false;
+
+        while (std::isspace(static_cast<unsigned char>(*pEnd)))
+            ++pEnd;
+        return *pEnd == '\0';
     }
 
-    void Parser::advanceUntil(const std::vector<TokenType>& tokenTypes) {
-        advance(); // always skip the first one
+    bool CVARStorage::applyValue(const std::string& name, CVariable& cvar, void* pData, const std::string& value, bool fromArchive) {
+        if (cvar.clamp && !isWholeNumber(value)) {
+            printf(OutputLevel::_ERROR, "\"{}\" must be a number, not \"{}\"\n", name, value);
+            return false;
+        }
 
-        // checks if EOF is reached because if not, it would run forever
-        while (std::find(tokenTypes.begin(), tokenTypes.end(), currentToken.getType()) == tokenTypes.end() && currentToken.getType() != TokenType::_EOF)
-            advance();
-    }
+        std::string oldValue = cvar.toString(pData);
+        cvar.set(pData, value);
 
-    std::vector<std::string> Parser::getArguments() {
-        std::vector<std::string> arguments;
+        // set may read the number differently than strtod, so what it stored is what gets clamped
+        if (cvar.clamp) {
+            double number = std::strtod(cvar.toString(pData).c_str(), nullptr);
+            if (number < cvar.minValue || number > cvar.maxValue)
+                cvar.set(pData, numberToString(number < cvar.minValue ? cvar.minValue : cvar.maxValue));
+        }
 
-        while (currentToken.getType() != TokenType::_EOF && currentToken.getType() != TokenType::EOS) {
-            // yes... it's just appending command type
-            if (currentToken.getType() == TokenType::COMMAND)
-                arguments.push_back(currentToken.getValue());
-            
-            else if (currentToken.getType() == TokenType::STRING) {
-                std::string result = "";
-                size_t position = 0;
-                
-                while (position < currentToken.getValue().length()) {
-                    if (currentToken.getValue()[position] == '$') { // if is variable or cvariable
-                        // get variable name
-                        
-                        position++; // skip '$'
+        if (cvar.toString(pData) != oldValue)
+            notifyChange(name, cvar, fromArchive);
 
-                        std::string variable = "";
-                        while (position < currentToken.getValue().length() && currentToken.getValue()[position] != ' ' && currentToken.getValue()[position] != '"') {
-                            variable += currentToken.getValue()[position];
-                            position++;
-                        }
-                        
-                        auto it = pVariables->find(variable);
-                        if (it != pVariables->end())
-                            result += it->second; // add variable
-                        
-                        else { // search in cvars
-                            CVariable* pCvar = nullptr;
-                            Command* pCommand = nullptr;
-                            if (CVARStorage::getCvar(variable, pCvar) && Command::getCommand(variable, pCommand, false))
-                                result += pCvar->toString(pCommand->pData);
-                            else
-                                result += "$" + variable; // or else just add with the $
-                        }
+        return true;
+    }
 
-                        continue;
-                    }
+    void CVARStorage::notifyChange(const std::string& name, CVariable& cvar, bool fromArchive) {
+        if (!cvar.dirty) {
+            cvar.dirty = true;
+            dirtyCvars.push_back(name);
+        }
 
-                    if (currentToken.getValue()[position] == '\\' && position+1 < currentToken.getValue().length() && currentToken.getValue()[position+1] == '$')
-                        position++;
+        if ((cvar.flags & ARCHIVE) && !fromArchive && !cvar.unsaved) {
+            cvar.unsaved = true;
+            unsavedCvars.push_back(name);
+        }
 
-                    result += currentToken.getValue()[position];
-                    position++;
-                }
+        if (cvar.callback == nullptr)
+            return;
 
-                arguments.push_back(result);
-            }
+        if (!cvar.coalesce)
+            cvar.callback(cvar.pCallbackData, name, cvar.toString(cvar.pData));
 
-            advance();
+        else if (!cvar.pending) {
+            cvar.pending = true;
+            pendingCvars.push_back(name);
         }
-
-        return arguments;
     }
 
-    std::string Parser::getVariableFromCurrentTokenValue() {
-        auto it = pVariables->find(currentToken.getValue());
-        if (it != pVariables->end())
-            return it->second;
-        return "";
+    bool CVARStorage::setCallback(const std::string& name, void* pData, CvarCallback callback, bool coalesce) {
+        CVariable* pCvar = nullptr;
+        if (!getCvar(name, pCvar))
+            return false;
+
+        pCvar->callback = callback;
+        pCvar->pCallbackData = pData;
+        pCvar->coalesce = coalesce;
+        return true;
     }
 
-    void Parser::handleCommandToken() {
-        std::string commandString = currentToken.getValue();
+    void CVARStorage::dispatchChanges() {
+        // callbacks may change cvars again, those are left for the next dispatch
+        std::vector<std::string> names;
+        names.swap(pendingCvars);
 
-        Command* pCommand = nullptr;
-        if (!Command::getCommand(commandString, pCommand, true))
-            return;
+        for (const auto& name : names) {
+            CVariable* pCvar = nullptr;
+            Command* pCommand = nullptr;
+            if (!getCvar(name, pCvar))
+                continue;
 
-        advance(); // skips the command token
+            pCvar->pending = false;
+            if (pCvar->callback == nullptr || !Command::getCommand(name, pCommand, false))
+                continue;
 
-        pLexer->ctx.args = getArguments();
+            pCvar->callback(pCvar->pCallbackData, name, pCvar->toString(pCommand->pData));
+        }
+    }
 
-        // make it include whitespaces in that case
-        if (pCommand->maxArgs == 1 && !pLexer->ctx.args.empty()) {
-            std::string stringBuilder;
-            for (const auto& argument : pLexer->ctx.args)
-                stringBuilder += argument + " ";
+    const std::vector<std::string>& CVARStorage::getDirtyCvars() {
+        return dirtyCvars;
+    }
 
-            stringBuilder.pop_back(); // remove last space
-            pLexer->ctx.args.clear();
-            pLexer->ctx.args.push_back(stringBuilder);
+    void CVARStorage::clearDirtyCvars() {
+        for (const auto& name : dirtyCvars) {
+            CVariable* pCvar = nullptr;
+            if (getCvar(name, pCvar))
+                pCvar->dirty = false;
         }
 
-        // checks if arguments size is within the allowed
-        if (pLexer->ctx.args.size() > (size_t)pCommand->maxArgs || pLexer->ctx.args.size() < (size_t)pCommand->minArgs) {
-            Command::printUsage(*pCommand);
-            if (!pLexer->ctx.args.empty())
-                print(OutputLevel::ECHO, "arguments size must be within range [" + std::to_string(pCommand->minArgs) + "," + std::to_string(pCommand->maxArgs) + "], but size is " + std::to_string(pLexer->ctx.args.size()) + '\n');
-            return;
-        }
+        dirtyCvars.clear();
+    }
 
-        if (pCommand->name[0] == '+') {
-            if (std::find(toggleTypesRunning.begin(), toggleTypesRunning.end(), pCommand->name.substr(1)) != toggleTypesRunning.end())
-                return;
-            
-            toggleTypesRunning.push_back(pCommand->name.substr(1));
-        }
-            
-        else if (pCommand->name[0] == '-') {
-            auto it = std::find(toggleTypesRunning.begin(), toggleTypesRunning.end(), pCommand->name.substr(1));
-            if (it == toggleTypesRunning.end())
-                return;
-            
-            toggleTypesRunning.erase(it);
-        }
+    void CVARStorage::setCheatsEnabled(bool enabled) {
+        cheatsEnabled = enabled;
+    }
 
-        pCommand->run(pLexer->ctx);
+    bool CVARStorage::areCheatsEnabled() {
+        return cheatsEnabled;
     }
 
-    bool Parser::isSpecialAlias() {
-        std::string varName = currentToken.getValue();
-        char front = varName.front();
-        
-        if (front == '!') {
-            auto it = std::find(loopAliasesRunning.begin(), loopAliasesRunning.end(), varName);
-            // if is already running, stop
-            if (it != loopAliasesRunning.end())
-                loopAliasesRunning.erase(it);
-            else // if not, make it run
-                loopAliasesRunning.push_back(varName);
-            
-            return false;
+    static void appendArchiveLine(std::string& content, const std::string& name, const std::string& value) {
+        content += name;
+        content += " \"";
+        for (const auto& c : value) {
+            if (c == '\\' || c == '"')
+                content += '\\';
+            content += c;
         }
-        
-        if (front == '+') { // if it is not running, start
-            auto it = std::find(toggleTypesRunning.begin(), toggleTypesRunning.end(), varName.substr(1));
-            if (it == toggleTypesRunning.end()) {
-                toggleTypesRunning.push_back(varName.substr(1));
-                return true;
-            }
+        content += "\"\n";
+    }
 
-            return false;
+    bool CVARStorage::saveCvars(const std::string& path) {
+        // old values are only dropped once they are most of the file
+        bool rewrite = path != archivePath || archiveLineCount + unsavedCvars.size() > archivedCount * 2 + 16;
+        if (!rewrite && unsavedCvars.empty())
+            return true;
+
+        std::vector<std::string> names;
+        if (rewrite) {
+            for (const auto& it : cvars)
+                if (it.second.flags & ARCHIVE)
+                    names.push_back(it.first);
+
+            std::sort(names.begin(), names.end());
+        } else
+            names = unsavedCvars;
+
+        std::string content;
+        for (const auto& name : names) {
+            CVariable& cvar = cvars[name];
+            appendArchiveLine(content, name, cvar.toString(cvar.pData));
         }
-        
-        if (front == '-') { // else: the + version had already ran, so now it will turn off
-            auto it = std::find(toggleTypesRunning.begin(), toggleTypesRunning.end(), varName.substr(1));
 
-            if (it != toggleTypesRunning.end()) {
-                toggleTypesRunning.erase(it);
-                return true;
-            }
-            
+        std::ofstream file(path, rewrite ? std::ios::trunc : std::ios::app);
+        if (!(file << content))
             return false;
-        }
 
+        for (const auto& name : unsavedCvars)
+            cvars[name].unsaved = false;
+        unsavedCvars.clear();
+
+        archivePath = path;
+        archiveLineCount = rewrite ? names.size() : archiveLineCount + names.size();
         return true;
     }
 
-    void Parser::handleAliasLexer(const std::string& input) {
-        std::vector<Lexer*> tempLexers;
-        tempLexers.push_back(pLexer);
-
-        pLexer->ctx.runningFrom |= ALIAS;
+    bool CVARStorage::loadCvars(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
 
-        pLexer = new Lexer(pLexer->ctx, input);
-        advance();
+        std::string content = readStream(file);
 
-        while (currentToken.getType() != TokenType::_EOF) {
-            std::string variable = getVariableFromCurrentTokenValue();
+        // each line is: name "value", later lines replace earlier ones
+        size_t lineCount = 0;
+        size_t position = 0;
+        while (position < content.size()) {
+            size_t nameEnd = content.find_first_of(" \n", position);
+            if (nameEnd == std::string::npos)
+                break;
 
-            if (!variable.empty()) {
-                if (isSpecialAlias()) {
-                    tempLexers.push_back(pLexer);
-                    pLexer = new Lexer(pLexer->ctx, variable);
+            std::string name = content.substr(position, nameEnd - position);
+            std::string value;
+            bool hasValue = content[nameEnd] == ' ' && nameEnd + 1 < content.size() && content[nameEnd+1] == '"';
+
+            position = nameEnd;
+            if (hasValue) {
+                // "\\" and "\"" are escaped like in Lexer::parseString
+                position += 2;
+                while (position < content.size() && content[position] != '"') {
+                    size_t next = std::min(content.find_first_of("\\\"", position), content.size());
+                    value.append(content, position, next - position);
+                    position = next;
+
+                    if (position + 1 < content.size() && content[position] == '\\' && (content[position+1] == '\\' || content[position+1] == '"')) {
+                        value += content[position+1];
+                        position += 2;
+                    } else if (position < content.size() && content[position] == '\\') {
+                        value += '\\';
+                        ++position;
+                    }
                 }
             }
 
-            else if (currentToken.getType() == TokenType::COMMAND)
-                handleCommandToken();
+            position = content.find('\n', position);
+            position = position == std::string::npos ? content.size() : position + 1;
+            ++lineCount;
 
-            else if (currentToken.getType() == TokenType::STRING) {
-                printUnknownCommand(currentToken.getValue());
-                advanceUntil({ TokenType::EOS });
+            CVariable* pCvar = nullptr;
+            if (!hasValue || !getCvar(name, pCvar))
+                continue;
+
+            try {
+                applyValue(name, *pCvar, pCvar->pData, value, true);
+            } catch (...) {
+                printf(OutputLevel::_ERROR, "could not load \"{}\" from \"{}\"\n", name, path);
             }
+        }
 
-            advance();
+        archivePath = path;
+        archiveLineCount = lineCount;
+        return true;
+    }
 
-            if (tempLexers.size() == aliasMaxCalls) {
-                delete pLexer;
+    HostMap<std::string, CVariable> CVARStorage::cvars;
+    std::vector<std::string> CVARStorage::pendingCvars;
+    std::vector<std::string> CVARStorage::dirtyCvars;
+    std::vector<std::string> CVARStorage::unsavedCvars;
+    bool CVARStorage::cheatsEnabled = false;
+    std::string CVARStorage::archivePath;
+    size_t CVARStorage::archiveLineCount = 0;
+    size_t CVARStorage::archivedCount = 0;
+
+    HostMap<std::string, std::vector<std::string>> AliasGraph::references;
+    HostMap<std::string, std::unordered_set<std::string>> AliasGraph::callers;
+    unsigned long long AliasGraph::generation = 0;
+
+    static bool isSpecialAliasName(const std::string& name) {
+        return name.front() == '!' || name.front() == '+' || name.front() == '-';
+    }
 
-                for (size_t i = 1; i < tempLexers.size(); ++i) {
-                    delete tempLexers[i];
-                }
+    void AliasGraph::setAlias(const std::string& name, const std::string& commands) {
+        removeAlias(name);
 
-                break;
-            }
+        // only the first token of each statement is called
+        std::vector<std::string>& names = references[name];
+        Lexer lexer{CommandContext{}, commands};
+        bool isStatementStart = true;
+        size_t calledBeforeWait = static_cast<size_t>(-1); // names[calledBeforeWait...] are only called after a wait
 
-            while (currentToken.getType() == TokenType::_EOF && tempLexers.size() > 1) {
-                delete pLexer;
+        for (Token token = lexer.nextToken(); token.getType() != TokenType::_EOF; token = lexer.nextToken()) {
+            if (token.getType() == TokenType::EOS) {
+                isStatementStart = true;
+                continue;
+            }
 
-                pLexer = tempLexers.back();
-                advance();
+            if (isStatementStart && token.getValue() == "wait" && calledBeforeWait == static_cast<size_t>(-1))
+                calledBeforeWait = names.size();
 
-                tempLexers.pop_back();
+            if (isStatementStart && !token.getValue().empty() && std::find(names.begin(), names.end(), token.getValue()) == names.end()) {
+                names.push_back(token.getValue());
+                callers[token.getValue()].insert(name);
             }
+
+            isStatementStart = false;
         }
 
+        // a loop that waits before calling itself again runs once per frame, which is what it is meant to do
+        std::vector<std::string> cycle;
+        auto waitIt = names.begin() + std::min(calledBeforeWait, names.size());
+        if (findCycle(name, cycle) && std::find(names.begin(), waitIt, cycle[1]) != waitIt) {
+            std::string path = cycle[0];
+            for (size_t i = 1; i < cycle.size(); ++i)
+                path += " -> " + cycle[i];
+
+            printf(OutputLevel::WARNING, "alias \"{}\" calls itself: {}\n", name, path);
+        }
+    }
+
+    void AliasGraph::removeAlias(const std::string& name) {
+        ++generation;
+
+        auto it = references.find(name);
+        if (it == references.end())
+            return;
+
+        for (const auto& called : it->second) {
+            auto callersIt = callers.find(called);
+            if (callersIt == callers.end())
+                continue;
+
+            callersIt->second.erase(name);
+            if (callersIt->second.empty())
+                callers.erase(callersIt);
+        }
+
+        references.erase(it);
+    }
+
+    bool AliasGraph::findCycle(const std::string& name, std::vector<std::string>& pathOut) {
+        pathOut.clear();
+        if (name.empty() || isSpecialAliasName(name))
+            return false;
+
+        std::unordered_set<std::string> visited = {name};
+        std::vector<std::pair<const std::string*, size_t>> stack = {{&name, 0}}; // alias and index of the next reference to follow
+
+        while (!stack.empty()) {
+            auto it = references.find(*stack.back().first);
+            if (it == references.end() || stack.back().second >= it->second.size()) {
+                stack.pop_back();
+                continue;
+            }
+
+            const std::string& next = it->second[stack.back().second++];
+            if (next == name) {
+                for (const auto& pair : stack)
+                    pathOut.push_back(*pair.first);
+                pathOut.push_back(name);
+                return true;
+            }
+
+            if (isSpecialAliasName(next) || references.count(next) == 0 || !visited.insert(next).second)
+                continue;
+
+            stack.emplace_back(&next, 0);
+        }
+
+        return false;
+    }
+
+    const std::vector<std::string>& AliasGraph::getReferences(const std::string& name) {
+        static const std::vector<std::string> empty;
+
+        auto it = references.find(name);
+        if (it == references.end())
+            return empty;
+        return it->second;
+    }
+
+    std::vector<std::string> AliasGraph::getDependents(const std::string& name) {
+        std::vector<std::string> dependents;
+        std::unordered_set<std::string> visited = {name};
+
+        auto it = callers.find(name);
+        if (it == callers.end())
+            return dependents;
+
+        for (const auto& caller : it->second)
+            if (visited.insert(caller).second)
+                dependents.push_back(caller);
+
+        for (size_t i = 0; i < dependents.size(); ++i) {
+            it = callers.find(dependents[i]);
+            if (it == callers.end())
+                continue;
+
+            for (const auto& caller : it->second)
+                if (visited.insert(caller).second)
+                    dependents.push_back(caller);
+        }
+
+        return dependents;
+    }
+
+    void AliasGraph::changed() {
+        ++generation;
+    }
+
+    unsigned long long AliasGraph::getGeneration() {
+        return generation;
+    }
+
+    void AliasGraph::clear() {
+        references.clear();
+        callers.clear();
+        ++generation;
+    }
+
+    std::vector<std::string> loopAliasesRunning = {};
+    std::vector<std::string> toggleTypesRunning = {};
+
+    void handleLoopAliasesRunning(std::unordered_map<std::string, std::string>* pVariables) {
+        for (auto& loopAlias : loopAliasesRunning) {
+            Lexer lexer{ { .runningFrom = ALIAS|LOOP_ALIAS|INTERNAL }, pVariables->at(loopAlias)};
+            Parser(&lexer, pVariables).parse();
+        }
+    }
+
+    Parser::Parser(Lexer* pLexer, std::unordered_map<std::string, std::string>* pVariables) : pLexer(pLexer), isNewInput(true), pVariables(pVariables) {
+        advance();
+    }
+
+    Parser::Parser(ParserState& state, std::unordered_map<std::string, std::string>* pVariables) : recordId(state.recordId), pVariables(pVariables) {
+        // a finished parse leaves the state empty, resuming it is like parsing an empty input
+        if (state.lexers.empty()) {
+            static Lexer finishedLexer{CommandContext(), ""}; // never advanced, it is only read for its ctx
+            pLexer = &finishedLexer;
+            currentToken = Token(TokenType::_EOF, "");
+            return;
+        }
+
+        pLexer = &state.lexers[0];
+        for (size_t i = 1; i < state.lexers.size(); ++i) {
+            tempLexers.push_back(pLexer);
+            pLexer = newAliasLexer(state.lexers[i]);
+        }
+
+        runningAliases = state.runningAliases;
+        runningAliases.resize(tempLexers.size());
+
+        if (Tracer::isEnabled())
+            for (size_t i = 0; i < runningAliases.size(); ++i)
+                Tracer::begin("alias", runningAliases[i].first, &state.lexers[i+1].ctx);
+
+        if (state.currentToken.getType() == TokenType::NOTHING)
+            advance();
+        else
+            currentToken = state.currentToken;
+    }
+
+    Parser::~Parser() {
+        deleteAliasLexers();
+    }
+
+    void Parser::deleteAliasLexers() {
+        if (tempLexers.empty())
+            return;
+
+        deleteAliasLexer(pLexer);
+        for (size_t i = tempLexers.size() - 1; i >= 1; --i)
+            deleteAliasLexer(tempLexers[i]);
+    }
+
+    void Parser::advance() {
+        pLexer->nextToken(currentToken);
+    }
+
+    void Parser::advanceUntil(std::initializer_list<TokenType> tokenTypes) {
+        advance(); // always skip the first one
+
+        // checks if EOF is reached because if not, it would run forever
+        while (std::find(tokenTypes.begin(), tokenTypes.end(), currentToken.getType()) == tokenTypes.end() && currentToken.getType() != TokenType::_EOF)
+            advance();
+    }
+
+    void Parser::getArguments(Arguments& arguments) {
+        arguments.clear();
+
+        while (currentToken.getType() != TokenType::_EOF && currentToken.getType() != TokenType::EOS) {
+            const std::string& value = currentToken.getValue();
+
+            // yes... it's just appending command type
+            if (currentToken.getType() == TokenType::COMMAND || (currentToken.getType() == TokenType::STRING && value.find('$') == std::string::npos))
+                arguments.push_back(value);
+            
+            else if (currentToken.getType() == TokenType::STRING) {
+                std::string& result = arguments.emplace_back();
+                size_t position = 0;
+                
+                while (position < value.length()) {
+                    if (value[position] == '$') { // if is variable or cvariable
+                        // get variable name
+                        
+                        position++; // skip '$'
+
+                        size_t start = position;
+                        while (position < value.length() && value[position] != ' ' && value[position] != '"')
+                            position++;
+                        std::string variable = value.substr(start, position - start);
+                        
+                        auto it = pVariables->find(variable);
+                        if (it != pVariables->end())
+                            result += it->second; // add variable
+                        
+                        else { // search in cvars
+                            CVariable* pCvar = nullptr;
+                            Command* pCommand = nullptr;
+                            if (CVARStorage::getCvar(variable, pCvar) && Command::getCommand(variable, pCommand, false))
+                                result += pCvar->toString(pCommand->pData);
+                            else {
+                                result += '$'; // or else just add with the $
+                                result += variable;
+                            }
+                        }
+
+                        continue;
+                    }
+
+                    if (value[position] == '\\' && position+1 < value.length() && value[position+1] == '$')
+                        position++;
+
+                    result += value[position];
+                    position++;
+                }
+            }
+
+            advance();
+        }
+    }
+
+    const std::string* Parser::getVariableFromCurrentTokenValue() {
+        auto it = pVariables->find(currentToken.getValue());
+        if (it != pVariables->end())
+            return &it->second;
+        return nullptr;
+    }
+
+    /// @brief what is left to do once the arguments of a command are known, for the parser and invoke
+    /// @return true if it ran
+    static bool runCommand(Command& command, CommandContext& ctx) {
+        Arguments& arguments = ctx.args;
+
+        // make it include whitespaces in that case
+        if (command.maxArgs == 1 && arguments.size() > 1) {
+            for (size_t i = 1; i < arguments.size(); ++i) {
+                arguments[0] += ' ';
+                arguments[0] += arguments[i];
+            }
+
+            arguments.resize(1);
+        }
+
+        // checks if arguments size is within the allowed
+        if (arguments.size() > (size_t)command.maxArgs || arguments.size() < (size_t)command.minArgs) {
+            Command::printUsage(command);
+            if (!arguments.empty())
+                print(OutputLevel::ECHO, "arguments size must be within range [" + std::to_string(command.minArgs) + "," + std::to_string(command.maxArgs) + "], but size is " + std::to_string(arguments.size()) + '\n');
+            return false;
+        }
+
+        if (command.name[0] == '+') {
+            if (std::find(toggleTypesRunning.begin(), toggleTypesRunning.end(), command.name.substr(1)) != toggleTypesRunning.end())
+                return false;
+            
+            toggleTypesRunning.push_back(command.name.substr(1));
+            AliasGraph::changed();
+        }
+            
+        else if (command.name[0] == '-') {
+            auto it = std::find(toggleTypesRunning.begin(), toggleTypesRunning.end(), command.name.substr(1));
+            if (it == toggleTypesRunning.end())
+                return false;
+            
+            toggleTypesRunning.erase(it);
+            AliasGraph::changed();
+        }
+
+        command.run(ctx);
+        return true;
+    }
+
+    // how many parses, ticks, execs and invokes are running, the Recorder only records the outermost
+    static unsigned int runningDepth = 0;
+
+    struct RunningScope {
+        RunningScope() {
+            ++runningDepth;
+        }
+
+        ~RunningScope() {
+            --runningDepth;
+        }
+    };
+
+    static unsigned long long lastRecordId = 0; // see ParserState::recordId
+
+    /// @return microseconds since the Recorder started
+    static unsigned long long getRecordingMicroseconds();
+
+    static std::vector<std::unique_ptr<CommandContext>> invokeContexts; // one for each invoke running, reused by the next ones
+    static size_t invokeDepth = 0;
+
+    static CommandContext& takeInvokeContext() {
+        if (invokeDepth == invokeContexts.size())
+            invokeContexts.emplace_back(new CommandContext());
+
+        CommandContext& ctx = *invokeContexts[invokeDepth++];
+        ctx.args.clear();
+        ctx.pCommand = nullptr;
+        ctx.filePath.clear();
+        ctx.runningFrom = INTERNAL;
+        ctx.lineIndex = ctx.columnIndex = ctx.lineCount = 0;
+        ctx.sourceId = 0;
+
+        return ctx;
+    }
+
+    _InvokeScope::_InvokeScope() : ctx(takeInvokeContext()) {}
+
+    _InvokeScope::~_InvokeScope() {
+        --invokeDepth;
+    }
+
+    bool _invoke(CommandHandle& handle, CommandContext& ctx) {
+        if (runningDepth == 0 && Recorder::isRecording())
+            Recorder::recordInvoke(handle.name, ctx.args);
+
+        RunningScope running;
+        Command* pCommand = nullptr;
+        if (handle.generation == commandsRemoved && handle.index < Command::commands.size())
+            pCommand = &Command::commands[handle.index];
+        else if (Command::getCommand(handle.name, pCommand, true)) {
+            handle.index = static_cast<size_t>(pCommand - Command::commands.data());
+            handle.generation = commandsRemoved;
+        } else
+            return false;
+
+        // a wait it asks for would stop whatever Parser runs next, the one running now, if any, keeps its own
+        unsigned int pendingWait = Scheduler::pendingWait;
+        bool ran = runCommand(*pCommand, ctx);
+        Scheduler::pendingWait = pendingWait;
+
+        return ran;
+    }
+
+    void Parser::handleCommandToken() {
+        const std::string& commandString = currentToken.getValue();
+
+        Command* pCommand = nullptr;
+        if (!Command::getCommand(commandString, pCommand, true))
+            return;
+
+        advance(); // skips the command token
+
+        getArguments(pLexer->ctx.args);
+        runCommand(*pCommand, pLexer->ctx);
+    }
+
+    bool Parser::isSpecialAlias() {
+        const std::string& varName = currentToken.getValue();
+        char front = varName.front();
+        
+        if (front == '!') {
+            auto it = std::find(loopAliasesRunning.begin(), loopAliasesRunning.end(), varName);
+            // if is already running, stop
+            if (it != loopAliasesRunning.end())
+                loopAliasesRunning.erase(it);
+            else // if not, make it run
+                loopAliasesRunning.push_back(varName);
+            
+            return false;
+        }
+        
+        if (front == '+') { // if it is not running, start
+            auto it = std::find(toggleTypesRunning.begin(), toggleTypesRunning.end(), varName.substr(1));
+            if (it == toggleTypesRunning.end()) {
+                toggleTypesRunning.push_back(varName.substr(1));
+                AliasGraph::changed();
+                return true;
+            }
+
+            return false;
+        }
+        
+        if (front == '-') { // else: the + version had already ran, so now it will turn off
+            auto it = std::find(toggleTypesRunning.begin(), toggleTypesRunning.end(), varName.substr(1));
+
+            if (it != toggleTypesRunning.end()) {
+                toggleTypesRunning.erase(it);
+                AliasGraph::changed();
+                return true;
+            }
+            
+            return false;
+        }
+
+        return true;
+    }
+
+    void Parser::handleAliasLexer(const std::string& name, const std::string& input) {
+        if (isRunningForever(name)) {
+            printf(OutputLevel::_ERROR, "alias \"{}\" calls itself forever\n", name);
+            stopAliases();
+            return;
+        }
+
+        pLexer->ctx.runningFrom |= ALIAS;
+
+        tempLexers.push_back(pLexer);
+        runningAliases.emplace_back(name, AliasGraph::getGeneration());
+        pLexer = newAliasLexer(pLexer->ctx, input);
+
+        if (Tracer::isEnabled())
+            Tracer::begin("alias", name, &pLexer->ctx);
+    }
+
+    void Parser::endAliasTraces(size_t count) {
+        if (Tracer::isEnabled())
+            for (size_t i = 0; i < count; ++i)
+                Tracer::end("alias");
+    }
+
+    bool Parser::isRunningForever(const std::string& name) {
+        unsigned long long generation = AliasGraph::getGeneration();
+
+        // aliases pushed before the last change could do something different now
+        for (auto it = runningAliases.rbegin(); it != runningAliases.rend() && it->second == generation; ++it)
+            if (it->first == name)
+                return true;
+
+        return false;
+    }
+
+    void Parser::stopAliases() {
+        if (tempLexers.empty())
+            return;
+
+        endAliasTraces(runningAliases.size());
+        deleteAliasLexers();
+
         pLexer = tempLexers[0];
-        advanceUntil({ TokenType::EOS }); // if there's something between the alias and the end of statement, we don't care!
+        tempLexers.clear();
+        runningAliases.clear();
+
+        advanceUntil({ TokenType::EOS });
+    }
+
+    void Parser::popAliasLexers() {
+        if (!tempLexers.empty() && tempLexers.size() == aliasMaxCalls) {
+            stopAliases();
+            advance();
+            return;
+        }
+
+        while (currentToken.getType() == TokenType::_EOF && !tempLexers.empty()) {
+            deleteAliasLexer(pLexer);
+
+            pLexer = tempLexers.back();
+            tempLexers.pop_back();
+            runningAliases.pop_back();
+            endAliasTraces(1);
+
+            if (tempLexers.empty())
+                advanceUntil({ TokenType::EOS }); // if there's something between the alias and the end of statement, we don't care!
+
+            advance();
+        }
+    }
+
+    void Parser::suspend(ParserState& stateOut) {
+        // stateOut may be the state this Parser is running on, so it's only replaced at the end
+        ParserState state;
+        for (auto& pTempLexer : tempLexers)
+            state.lexers.push_back(*pTempLexer);
+        state.lexers.push_back(*pLexer);
+        state.currentToken = std::move(currentToken);
+        state.runningAliases = runningAliases;
+        state.recordId = recordId;
+
+        if (!tempLexers.empty()) {
+            deleteAliasLexers();
+
+            pLexer = tempLexers[0];
+            tempLexers.clear();
+
+            endAliasTraces(runningAliases.size());
+            runningAliases.clear();
+        }
+
+        currentToken = Token(TokenType::_EOF, "");
+        stateOut = std::move(state);
+    }
+
+    bool Parser::parseStatement() {
+        bool ran = true;
+        const std::string* pVariableValue = getVariableFromCurrentTokenValue(); // the alias Lexer copies it before anything runs
+
+        if (pVariableValue != nullptr && !pVariableValue->empty()) {
+            if (isSpecialAlias())
+                handleAliasLexer(currentToken.getValue(), *pVariableValue);
+        }
+
+        else if (currentToken.getType() == TokenType::COMMAND) {
+            QuotaAction action;
+            if (RateLimiter::admit(pLexer->ctx, action))
+                handleCommandToken();
+
+            else if (action == QUOTA_DROP)
+                advanceUntil({ TokenType::EOS });
+
+            else { // the command runs again once resumed
+                ParserState state;
+                suspend(state);
+                Scheduler::waitFrames(std::move(state), 1);
+                return false;
+            }
+        }
+
+        else if (currentToken.getType() == TokenType::STRING) {
+            printUnknownCommand(currentToken.getValue());
+            advanceUntil({ TokenType::EOS });
+        }
+
+        else
+            ran = false;
+
+        advance();
+        popAliasLexers();
+
+        if (Scheduler::pendingWait != 0) {
+            unsigned int frames = Scheduler::pendingWait;
+            Scheduler::pendingWait = 0;
+
+            if (currentToken.getType() != TokenType::_EOF) {
+                ParserState state;
+                suspend(state);
+                Scheduler::waitFrames(std::move(state), frames);
+            }
+        }
+
+        return ran;
+    }
+
+    static const std::string parseTraceName = "parse";
+
+    bool Parser::isRecorded() const {
+        return runningDepth == 0 && Recorder::isRecording() && (isNewInput || recordId != 0);
+    }
+
+    void Parser::parse() {
+        if (isRecorded())
+            record(isNewInput, 0, getRecordingMicroseconds());
+
+        isNewInput = false;
+        RunningScope running;
+        TraceScope trace("parse", parseTraceName, &pLexer->ctx);
+
+        while (currentToken.getType() != TokenType::_EOF)
+            parseStatement();
+    }
+
+    bool Parser::parse(ParserState& stateOut, size_t maxStatements, unsigned long long maxMicroseconds) {
+        // it is only known at the end how many statements the budget let run, which is what gets recorded
+        bool recorded = isRecorded();
+        bool newInput = isNewInput;
+        unsigned long long recordedAt = recorded ? getRecordingMicroseconds() : 0;
+        isNewInput = false; // the rest of a budgeted parse is not new input
+
+        RunningScope running;
+        TraceScope trace("parse", parseTraceName, &pLexer->ctx);
+        auto start = std::chrono::steady_clock::now();
+        size_t statements = 0;
+
+        while (currentToken.getType() != TokenType::_EOF) {
+            if (!parseStatement())
+                continue;
+
+            ++statements;
+            if (currentToken.getType() == TokenType::_EOF)
+                break;
+
+            if ((maxStatements != 0 && statements >= maxStatements)
+              || (maxMicroseconds != 0 && (unsigned long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() >= maxMicroseconds)) {
+                if (recorded && newInput)
+                    recordId = ++lastRecordId;
+
+                // recorded first, stateOut may be the state pLexer is in, which suspend replaces
+                if (recorded)
+                    record(newInput, statements, recordedAt);
+                suspend(stateOut);
+
+                return false;
+            }
+        }
+
+        if (recorded)
+            record(newInput, 0, recordedAt);
+
+        stateOut = ParserState();
+        return true;
+    }
+
+    void Parser::reset(Lexer* pLexer) {
+        // a parse a throwing command unwound leaves its aliases running
+        endAliasTraces(runningAliases.size());
+        deleteAliasLexers();
+        tempLexers.clear();
+        runningAliases.clear();
+
+        this->pLexer = pLexer;
+        isNewInput = true;
+        recordId = 0;
+        advance();
+    }
+
+    Batch::Batch(const CommandContext& ctx, std::unordered_map<std::string, std::string>* pVariables)
+      : ctx(ctx), pVariables(pVariables), lexer(ctx, ""), parser(&lexer, pVariables) {}
+
+    void Batch::run(const std::string& input) {
+        run(input.data(), input.size());
+    }
+
+    void Batch::run(const char* pInput, size_t size) {
+        if (running) {
+            Lexer nestedLexer{ctx, std::string(pInput, size)};
+            Parser nestedParser{&nestedLexer, pVariables};
+            nestedParser.aliasMaxCalls = aliasMaxCalls;
+            nestedParser.parse();
+            return;
+        }
+
+        // the Batch is free again even if a command throws, and the aliases that command was running are dropped
+        struct RunningBatch {
+            Batch& batch;
+            bool finished = false;
+
+            ~RunningBatch() {
+                batch.running = false;
+                if (!finished) {
+                    batch.lexer.reset(batch.ctx, "", 0);
+                    batch.parser.reset(&batch.lexer);
+                }
+            }
+        } runningBatch{*this};
+
+        running = true;
+        lexer.reset(ctx, pInput, size);
+        parser.reset(&lexer);
+        parser.aliasMaxCalls = aliasMaxCalls;
+        parser.parse();
+        runningBatch.finished = true;
+    }
+
+    void Batch::run(const std::string* pInputs, size_t count) {
+        for (size_t i = 0; i < count; ++i)
+            run(pInputs[i].data(), pInputs[i].size());
+    }
+
+    void Batch::run(const std::vector<std::string>& inputs) {
+        run(inputs.data(), inputs.size());
+    }
+
+    static const unsigned long long waitedGeneration = static_cast<unsigned long long>(-1); // never the AliasGraph generation
+
+    Scheduler::Tasks Scheduler::frameTasks;
+    Scheduler::Tasks Scheduler::timerTasks;
+    unsigned long long Scheduler::frame = 0;
+    unsigned long long Scheduler::taskCount = 0;
+    unsigned int Scheduler::pendingWait = 0;
+
+    bool Scheduler::isDueLater(const Task& a, const Task& b) {
+        if (a.due != b.due)
+            return a.due > b.due;
+        return a.order > b.order;
+    }
+
+    static unsigned long long getMilliseconds() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void Scheduler::pushTask(Tasks& tasks, ParserState&& state, unsigned long long due) {
+        // waiting is progress, an alias that waits and then calls itself again is not calling itself forever
+        for (auto& runningAlias : state.runningAliases)
+            runningAlias.second = waitedGeneration;
+
+        tasks.push_back({std::move(state), due, taskCount++});
+        std::push_heap(tasks.begin(), tasks.end(), isDueLater);
+    }
+
+    void Scheduler::popDueTasks(Tasks& tasks, unsigned long long now, Tasks& out) {
+        while (!tasks.empty() && tasks.front().due <= now) {
+            std::pop_heap(tasks.begin(), tasks.end(), isDueLater);
+            out.push_back(std::move(tasks.back()));
+            tasks.pop_back();
+        }
+    }
+
+    void Scheduler::tick(std::unordered_map<std::string, std::string>* pVariables) {
+        if (runningDepth == 0 && Recorder::isRecording())
+            Recorder::recordTick();
+
+        RunningScope running;
+        ++frame;
+
+        // tasks scheduled while running the due ones only run on the next tick
+        Tasks dueTasks;
+        popDueTasks(frameTasks, frame, dueTasks);
+        popDueTasks(timerTasks, getMilliseconds(), dueTasks);
+
+        for (auto& task : dueTasks)
+            Parser(task.state, pVariables).parse();
+
+        CVARStorage::dispatchChanges();
+    }
+
+    void Scheduler::waitFrames(ParserState&& state, unsigned int frames) {
+        pushTask(frameTasks, std::move(state), frame + frames);
+    }
+
+    void Scheduler::waitMilliseconds(ParserState&& state, unsigned long long milliseconds) {
+        pushTask(timerTasks, std::move(state), getMilliseconds() + milliseconds);
+    }
+
+    void Scheduler::requestWait(unsigned int frames) {
+        pendingWait = frames;
+    }
+
+    void Scheduler::clear() {
+        frameTasks.clear();
+        timerTasks.clear();
+        pendingWait = 0;
+    }
+
+    size_t Scheduler::size() {
+        return frameTasks.size() + timerTasks.size();
+    }
+
+    unsigned long long Scheduler::getFrame() {
+        return frame;
+    }
+
+    struct TokenBucket {
+        double tokens;
+        std::chrono::steady_clock::time_point refilled;
+    };
+
+    struct Quota {
+        unsigned short source;
+        double commandsPerSecond;
+        double burst;
+        QuotaAction action;
+        QuotaScope scope;
+
+        TokenBucket shared;
+        HostMap<unsigned long long, TokenBucket> byId;
+        HostMap<std::string, TokenBucket> byFile;
+        QuotaCounters counters;
+    };
+
+    unsigned short RateLimiter::limitedSources = 0;
+    static std::vector<Quota> quotas;
+
+    static Quota* findQuota(unsigned short source) {
+        for (auto& quota : quotas)
+            if (quota.source == source)
+                return &quota;
+
+        return nullptr;
+    }
+
+    static TokenBucket& getBucket(Quota& quota, const CommandContext& ctx, std::chrono::steady_clock::time_point now) {
+        if (quota.scope == QUOTA_SHARED)
+            return quota.shared;
+
+        // new buckets start full
+        if (quota.scope == QUOTA_PER_ID) {
+            auto it = quota.byId.find(ctx.sourceId);
+            return it != quota.byId.end() ? it->second : quota.byId.emplace(ctx.sourceId, TokenBucket{quota.burst, now}).first->second;
+        }
+
+        auto it = quota.byFile.find(ctx.filePath);
+        return it != quota.byFile.end() ? it->second : quota.byFile.emplace(ctx.filePath, TokenBucket{quota.burst, now}).first->second;
+    }
+
+    void RateLimiter::setQuota(unsigned short source, double commandsPerSecond, double burst, QuotaAction action, QuotaScope scope) {
+        Quota* pQuota = findQuota(source);
+        if (pQuota == nullptr) {
+            quotas.emplace_back();
+            pQuota = &quotas.back();
+        }
+
+        *pQuota = Quota();
+        pQuota->source = source;
+        pQuota->commandsPerSecond = commandsPerSecond;
+        pQuota->burst = std::max(burst, 1.0);
+        pQuota->action = action;
+        pQuota->scope = scope;
+        pQuota->shared = {pQuota->burst, std::chrono::steady_clock::now()};
+
+        limitedSources |= source;
+    }
+
+    void RateLimiter::removeQuota(unsigned short source) {
+        quotas.erase(std::remove_if(quotas.begin(), quotas.end(), [source](const Quota& quota) { return quota.source == source; }), quotas.end());
+
+        limitedSources = 0;
+        for (const auto& quota : quotas)
+            limitedSources |= quota.source;
+    }
+
+    void RateLimiter::clear() {
+        quotas.clear();
+        limitedSources = 0;
+    }
+
+    bool RateLimiter::getCounters(unsigned short source, QuotaCounters& countersOut) {
+        Quota* pQuota = findQuota(source);
+        if (pQuota == nullptr)
+            return false;
+
+        countersOut = pQuota->counters;
+        return true;
+    }
+
+    void RateLimiter::forgetSource(unsigned short source, unsigned long long sourceId) {
+        Quota* pQuota = findQuota(source);
+        if (pQuota != nullptr)
+            pQuota->byId.erase(sourceId);
+    }
+
+    bool RateLimiter::admitLimited(const CommandContext& ctx, QuotaAction& actionOut) {
+        auto now = std::chrono::steady_clock::now();
+        TokenBucket* buckets[sizeof(limitedSources) * 8];
+        size_t bucketCount = 0;
+        bool admitted = true;
+        actionOut = QUOTA_DEFER;
+
+        for (auto& quota : quotas) {
+            if ((quota.source & ctx.runningFrom) == 0)
+                continue;
+
+            TokenBucket& bucket = getBucket(quota, ctx, now);
+            double seconds = std::chrono::duration<double>(now - bucket.refilled).count();
+            bucket.tokens = std::min(quota.burst, bucket.tokens + seconds * quota.commandsPerSecond);
+            bucket.refilled = now;
+
+            if (bucket.tokens >= 1) {
+                buckets[bucketCount++] = &bucket;
+                continue;
+            }
+
+            admitted = false;
+            if (quota.action == QUOTA_DROP) {
+                actionOut = QUOTA_DROP;
+                ++quota.counters.dropped;
+            } else
+                ++quota.counters.deferred;
+        }
+
+        if (!admitted)
+            return false;
+
+        // only taken once every quota agreed
+        for (size_t i = 0; i < bucketCount; ++i)
+            buckets[i]->tokens -= 1;
+
+        for (auto& quota : quotas)
+            if ((quota.source & ctx.runningFrom) != 0)
+                ++quota.counters.admitted;
+
+        return true;
+    }
+
+    /// @brief strips a line that has comment or quote characters, starting at the first of them
+    static void stripLine(std::string line, size_t first, bool& inComment, bool& inQuotes, std::string& content) {
+        bool removeOneFromIndex = false; // if it was left true by the previous line, i would underflow
+
+        for (size_t i = first; i < line.size(); ++i) {
+            if (removeOneFromIndex) {
+                --i;
+                removeOneFromIndex = false;
+            }
+
+            if (!inQuotes && line[i] == '*' && line.size()-1 != i) {
+                if (line[i+1] != '/') continue;
+
+                if (inComment) {
+                    inComment = false;
+                    line = line.substr(i+2);
+                    i = 0;
+                    removeOneFromIndex = true;
+                } else { // comment everything before and above
+                    content.clear();
+                    line = line.substr(i+2);
+                    i = 0;
+                    removeOneFromIndex = true;
+                }
+            
+                continue;
+            }
+
+            if (inComment) continue;
+
+            if (line[i] == '"' && (i == 0 || line[i-1] != '\\')) {
+                inQuotes = !inQuotes;
+                continue;
+            }
+
+            if (inQuotes) continue;
+
+            if (line[i] == '/' && line.size()-1 != i) {
+                if (line[i+1] == '*') {
+                    inComment = true;
+                    content.append(line, 0, i);
+                    i = 0;
+                    removeOneFromIndex = true;
+                    continue;
+                } else if (line[i+1] == '/') {
+                    line = line.substr(0, i);
+                    break;
+                }
+            }
+        }
+
+        if (!inComment) {
+            content += line;
+            if (!inQuotes)
+                content += '\n';
+        }
+    }
+
+    std::string stripComments(std::istream& file, size_t& lineCount) {
+        if (!file.good())
+            return "";
+
+        std::string input = readStream(file);
+
+        bool inComment = false;
+        bool inQuotes = false;
+
+        std::string content;
+        content.reserve(input.size() + 1);
+
+        // a line without any comment or quote character is copied as it is, the rest goes through stripLine
+        size_t lineStart = 0;
+        while (true) {
+            ++lineCount;
+
+            size_t first = findStructural<CommentCharacters>(input, lineStart, input.size());
+            size_t lineEnd = first;
+            if (first < input.size() && input[first] != '\n') {
+                lineEnd = input.find('\n', first);
+                if (lineEnd == std::string::npos)
+                    lineEnd = input.size();
+
+                stripLine(input.substr(lineStart, lineEnd - lineStart), first - lineStart, inComment, inQuotes, content);
+            } else if (!inComment) {
+                content.append(input, lineStart, lineEnd - lineStart);
+                if (!inQuotes)
+                    content += '\n';
+            }
+
+            if (lineEnd == input.size())
+                break;
+
+            lineStart = lineEnd + 1;
+        }
+
+        return content;
     }
 
-    void Parser::parse() {
-        while (currentToken.getType() != TokenType::_EOF) {
-            std::string variableValue = getVariableFromCurrentTokenValue();
+    struct DirectoryState {
+        bool exists;
+        time_t modified;
+        unsigned long long generation; // resolverGeneration when it was checked
+    };
+
+    struct FileLookup {
+        bool exists;
+        time_t directoryModified; // the lookup is only valid while the directory stays the same
+        time_t checked;
+    };
+
+    std::vector<std::string> PathResolver::searchPaths;
+    static HostMap<std::string, DirectoryState> resolverDirectories;
+    static HostMap<std::string, FileLookup> resolverFiles;
+    static unsigned long long resolverGeneration = 1;
+    static unsigned long long resolverProbes = 0;
+
+    static bool isAbsolutePath(const std::string& path) {
+        return !path.empty() && (path[0] == '/' || path[0] == '\\' || (path.size() > 1 && path[1] == ':'));
+    }
+
+    static std::string getDirectory(const std::string& path) {
+        size_t end = path.find_last_of("/\\");
+        return end == std::string::npos ? "." : path.substr(0, end == 0 ? 1 : end);
+    }
+
+    static std::string joinPath(const std::string& directory, const std::string& path) {
+        if (directory.empty() || directory == ".")
+            return path;
+
+        char last = directory.back();
+        return last == '/' || last == '\\' ? directory + path : directory + '/' + path;
+    }
+
+    void PathResolver::setSearchPaths(const std::vector<std::string>& paths) {
+        searchPaths = paths;
+    }
+
+    const std::vector<std::string>& PathResolver::getSearchPaths() {
+        return searchPaths;
+    }
+
+    bool PathResolver::resolve(const std::string& path, const std::string& fromFile, std::string& resolvedOut) {
+        if (isAbsolutePath(path)) {
+            resolvedOut = path;
+            return true;
+        }
 
-            if (!variableValue.empty()) {
-                if (isSpecialAlias())
-                    handleAliasLexer(variableValue);
+        if (!fromFile.empty()) {
+            std::string candidate = joinPath(getDirectory(fromFile), path);
+            if (exists(candidate)) {
+                resolvedOut = std::move(candidate);
+                return true;
             }
+        }
 
-            else if (currentToken.getType() == TokenType::COMMAND)
-                handleCommandToken();
+        if (exists(path)) {
+            resolvedOut = path;
+            return true;
+        }
 
-            else if (currentToken.getType() == TokenType::STRING) {
-                printUnknownCommand(currentToken.getValue());
-                advanceUntil({ TokenType::EOS });
+        for (const auto& searchPath : searchPaths) {
+            std::string candidate = joinPath(searchPath, path);
+            if (exists(candidate)) {
+                resolvedOut = std::move(candidate);
+                return true;
             }
+        }
 
-            advance();
+        return false;
+    }
+
+    void PathResolver::flush() {
+        resolverDirectories.clear();
+        resolverFiles.clear();
+    }
+
+    void PathResolver::expire() {
+        ++resolverGeneration;
+    }
+
+    unsigned long long PathResolver::getProbeCount() {
+        return resolverProbes;
+    }
+
+    static void checkDirectory(const std::string& directory, DirectoryState& directoryState) {
+        struct stat info;
+        ++resolverProbes;
+        directoryState.exists = stat(directory.c_str(), &info) == 0 && (info.st_mode & S_IFMT) == S_IFDIR;
+        directoryState.modified = directoryState.exists ? info.st_mtime : 0;
+        directoryState.generation = resolverGeneration;
+    }
+
+    bool PathResolver::exists(const std::string& path) {
+        // a file appearing or disappearing changes the modification time of its directory
+        std::string directory = getDirectory(path);
+        DirectoryState& directoryState = resolverDirectories[directory];
+        bool directoryChecked = directoryState.generation != resolverGeneration;
+        if (directoryChecked)
+            checkDirectory(directory, directoryState);
+
+        // a lookup made in the same second the directory changed may have missed a later change in that second
+        auto it = resolverFiles.find(path);
+        bool cached = it != resolverFiles.end() && it->second.checked > it->second.directoryModified;
+
+        // the running cfg may have just created it or its directory, so missing is only trusted right after looking at the directory
+        if (!directoryChecked && (!directoryState.exists || (cached && !it->second.exists)))
+            checkDirectory(directory, directoryState);
+
+        if (!directoryState.exists)
+            return false;
+
+        if (cached && it->second.directoryModified == directoryState.modified)
+            return it->second.exists;
+
+        struct stat info;
+
+        ++resolverProbes;
+        FileLookup lookup;
+        lookup.exists = stat(path.c_str(), &info) == 0 && (info.st_mode & S_IFMT) != S_IFDIR;
+        lookup.directoryModified = directoryState.modified;
+        lookup.checked = time(nullptr);
+        resolverFiles[path] = lookup;
+
+        return lookup.exists;
+    }
+
+    static bool readConfigFile(CommandContext ctx, const std::string& path, ParserState& stateOut) {
+        TraceScope trace("file", path);
+        std::ifstream file(path);
+
+        if (!file)
+            return false;
+
+        std::string content = stripComments(file, ctx.lineCount);
+
+        ctx.runningFrom |= FILE;
+        ctx.filePath = path;
+
+        stateOut = ParserState();
+        stateOut.lexers.emplace_back(ctx, content);
+        return true;
+    }
+
+    bool loadConfigFile(CommandContext ctx, const std::string& path, ParserState& stateOut) {
+        if (!readConfigFile(ctx, path, stateOut))
+            return false;
+
+        // the host runs the state itself, the Recorder follows it by its id
+        if (runningDepth == 0 && Recorder::isRecording()) {
+            stateOut.recordId = ++lastRecordId;
+            Recorder::recordLoad(ctx.runningFrom, path, stateOut.recordId);
         }
+
+        return true;
+    }
+
+    /// @brief what a file was when it was read, one with the same size and modification time was not written since
+    struct FileStamp {
+        long long size = -1; // -1 if it could not be stat'ed
+        time_t modified = 0;
+        long modifiedNanoseconds = 0;
+        time_t taken = 0; // a write later in the second the file was last modified may keep the same modification time
+    };
+
+    static FileStamp stampFile(const std::string& path) {
+        FileStamp stamp;
+        stamp.taken = time(nullptr);
+
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            return stamp;
+
+        stamp.size = info.st_size;
+        stamp.modified = info.st_mtime;
+#if defined(__linux__)
+        stamp.modifiedNanoseconds = info.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+        stamp.modifiedNanoseconds = info.st_mtimespec.tv_nsec;
+#endif
+        return stamp;
+    }
+
+    static bool isUnchanged(const FileStamp& before, const FileStamp& now) {
+        return before.size >= 0 && before.modified < before.taken && now.size == before.size
+            && now.modified == before.modified && now.modifiedNanoseconds == before.modifiedNanoseconds;
     }
 
+    // coalesced cvar callbacks wait for the outermost exec to end
+    static unsigned int execDepth = 0;
+
     void execConfigFile(CommandContext ctx, const std::string& path, std::unordered_map<std::string, std::string>* pVariables) {
-        std::ifstream file(path);
+        if (runningDepth == 0 && Recorder::isRecording())
+            Recorder::recordExec(ctx.runningFrom, path);
 
-        if (!file) {
+        RunningScope running;
+        ParserState state;
+        std::string resolvedPath;
+        if (execDepth == 0)
+            PathResolver::expire();
+
+        if (!PathResolver::resolve(path, ctx.filePath, resolvedPath) || !readConfigFile(ctx, resolvedPath, state)) {
             printf(OutputLevel::_ERROR, "could not load file \"{}\"\n", path);
             return;
         }
 
-        bool inComment = false;
-        bool inQuotes = false;
-        bool removeOneFromIndex = false;
-
-        std::stringstream content;
-        while (file.good()) {
-            std::string line;
-            std::getline(file, line);
-            ++ctx.lineCount;
-
-            for (size_t i = 0; i < line.size(); ++i) {
-                if (removeOneFromIndex) {
-                    --i;
-                    removeOneFromIndex = false;
-                }
+        ++execDepth;
+        Parser(state, pVariables).parse();
 
-                if (!inQuotes && line[i] == '*' && line.size()-1 != i) {
-                    if (line[i+1] != '/') continue;
-
-                    if (inComment) {
-                        inComment = false;
-                        line = line.substr(i+2);
-                        i = 0;
-                        removeOneFromIndex = true;
-                    } else { // comment everything before and above
-                        content.str(std::string());
-                        line = line.substr(i+2);
-                        i = 0;
-                        removeOneFromIndex = true;
-                    }
-                
+        if (--execDepth == 0) {
+            CVARStorage::dispatchChanges();
+            Memory::measure(pVariables);
+        }
+    }
+
+    void execConfigFiles(CommandContext ctx, const std::vector<std::string>& paths, std::unordered_map<std::string, std::string>* pVariables, unsigned int threadCount) {
+        std::vector<ParserState> states(paths.size());
+        std::vector<char> loaded(paths.size(), false);
+        std::vector<FileStamp> stamps(paths.size()); // what each file was when it was loaded
+
+        // resolving uses the cache, which is not shared with the threads
+        if (execDepth == 0)
+            PathResolver::expire();
+
+        std::vector<std::string> resolvedPaths(paths.size());
+        std::vector<char> resolved(paths.size(), false);
+        for (size_t i = 0; i < paths.size(); ++i)
+            resolved[i] = PathResolver::resolve(paths[i], ctx.filePath, resolvedPaths[i]);
+
+        if (threadCount == 0)
+            threadCount = std::thread::hardware_concurrency();
+        if (threadCount > paths.size())
+            threadCount = paths.size();
+
+        // loading does not touch the interpreter, only running has to be in order
+        std::atomic<size_t> nextPath{0};
+        auto load = [&]() {
+            for (size_t i = nextPath++; i < paths.size(); i = nextPath++) {
+                if (!resolved[i])
                     continue;
-                }
 
-                if (inComment) continue;
+                // stamped before reading, a write while it is read makes it look changed
+                stamps[i] = stampFile(resolvedPaths[i]);
+                loaded[i] = readConfigFile(ctx, resolvedPaths[i], states[i]);
+            }
+        };
 
-                if (line[i] == '"' && (i == 0 || line[i-1] != '\\')) {
-                    inQuotes = !inQuotes;
-                    continue;
-                }
+        std::vector<std::thread> threads;
+        for (unsigned int i = 1; i < threadCount; ++i)
+            threads.emplace_back(load);
+        load();
 
-                if (inQuotes) continue;
+        for (auto& thread : threads)
+            thread.join();
 
-                if (line[i] == '/' && line.size()-1 != i) {
-                    if (line[i+1] == '*') {
-                        inComment = true;
-                        content << line.substr(0, i);
-                        i = 0;
-                        removeOneFromIndex = true;
-                        continue;
-                    } else if (line[i+1] == '/') {
-                        line = line.substr(0, i);
-                        break;
-                    }
-                }
+        ++execDepth;
+        for (size_t i = 0; i < paths.size(); ++i) {
+            if (runningDepth == 0 && Recorder::isRecording())
+                Recorder::recordExec(ctx.runningFrom, paths[i]);
+
+            RunningScope running;
+
+            // the files run before it may have rewritten or created it, stripping it again is only needed then
+            if (!loaded[i] || !isUnchanged(stamps[i], stampFile(resolvedPaths[i]))) {
+                resolved[i] = PathResolver::resolve(paths[i], ctx.filePath, resolvedPaths[i]);
+                loaded[i] = resolved[i] && readConfigFile(ctx, resolvedPaths[i], states[i]);
             }
 
-            if (!inComment) {
-                content << line;
-                if (!inQuotes)
-                    content << '\n';
+            if (!loaded[i]) {
+                printf(OutputLevel::_ERROR, "could not load file \"{}\"\n", paths[i]);
+                continue;
             }
-            /*
-            if (inQuotes)
-                content << ' ';
-            else
-                content << ';';
-            */
+
+            Parser(states[i], pVariables).parse();
         }
 
-        ctx.runningFrom |= FILE;
-        ctx.filePath = path;
-        Lexer lexer = {ctx, content.str()};
-        Parser(&lexer, pVariables).parse();
+        if (--execDepth == 0) {
+            CVARStorage::dispatchChanges();
+            Memory::measure(pVariables);
+        }
+    }
+
+    /*
+     * A recording starts with recordingMagic, then each entry is:
+     * type(1 byte), runningFrom, microseconds since the previous entry, data size(all varints) and the data.
+     * Frames are not written, every Scheduler::tick is an entry of its own.
+     * States the host resumes are known by an id(see ParserState::recordId), given when they are loaded or first stop
+     */
+    static const std::string recordingMagic = "SweatCIrec2\n";
+
+    enum RecordType : unsigned char {
+        RECORD_INPUT = 0, // data is the input, parsed to the end
+        RECORD_EXEC, // data is the file path
+        RECORD_TICK, // no data
+        RECORD_INVOKE, // data is the command name and then each argument, each one is its size(varint) and the text
+        RECORD_LOAD, // data is the id(varint) and the file path
+        RECORD_PARSE_INPUT, // data is the id and how many statements ran(varints) and the input, which was stopped by the budget
+        RECORD_RESUME // data is the id and how many statements ran, 0 if it reached the end
+    };
+
+    bool Recorder::recording = false;
+    static std::ofstream recordingFile;
+    static std::string recordingBuffer;
+    static std::chrono::steady_clock::time_point recordingStart;
+    static unsigned long long lastRecordedMicroseconds = 0;
+
+    static void writeVarint(std::string& out, unsigned long long value) {
+        while (value >= 0x80) {
+            out += static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+
+        out += static_cast<char>(value);
+    }
+
+    static void writeString(std::string& out, const std::string& value) {
+        writeVarint(out, value.size());
+        out += value;
+    }
+
+    static bool readVarint(const std::string& in, size_t& position, unsigned long long& valueOut) {
+        valueOut = 0;
+        for (unsigned int shift = 0; position < in.size() && shift < 64; shift += 7) {
+            unsigned char byte = static_cast<unsigned char>(in[position++]);
+            valueOut |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    static bool readString(const std::string& in, size_t& position, std::string& valueOut) {
+        unsigned long long size;
+        if (!readVarint(in, position, size) || size > in.size() - position)
+            return false;
+
+        valueOut = in.substr(position, size);
+        position += size;
+        return true;
+    }
+
+    static void flushRecording() {
+        recordingFile.write(recordingBuffer.data(), recordingBuffer.size());
+        recordingBuffer.clear();
+    }
+
+    static unsigned long long getRecordingMicroseconds() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - recordingStart).count();
+    }
+
+    /// @param microseconds when it started, a parse is only recorded once it ends
+    static void recordEntry(RecordType type, unsigned short runningFrom, const std::string& data, unsigned long long microseconds = getRecordingMicroseconds()) {
+        recordingBuffer += static_cast<char>(type);
+        writeVarint(recordingBuffer, runningFrom);
+        writeVarint(recordingBuffer, microseconds >= lastRecordedMicroseconds ? microseconds - lastRecordedMicroseconds : 0);
+        writeString(recordingBuffer, data);
+
+        lastRecordedMicroseconds = std::max(microseconds, lastRecordedMicroseconds);
+
+        if (recordingBuffer.size() >= 65536)
+            flushRecording();
+    }
+
+    bool Recorder::start(const std::string& path) {
+        stop();
+
+        recordingFile.open(path, std::ios::binary | std::ios::trunc);
+        if (!recordingFile)
+            return false;
+
+        recordingBuffer = recordingMagic;
+        recordingStart = std::chrono::steady_clock::now();
+        lastRecordedMicroseconds = 0;
+        recording = true;
+        return true;
+    }
+
+    void Recorder::stop() {
+        if (!recording)
+            return;
+
+        flushRecording();
+        recordingFile.close();
+        recording = false;
+    }
+
+    void Recorder::recordInput(unsigned short runningFrom, const std::string& input) {
+        recordEntry(RECORD_INPUT, runningFrom, input);
+    }
+
+    void Recorder::recordExec(unsigned short runningFrom, const std::string& path) {
+        recordEntry(RECORD_EXEC, runningFrom, path);
+    }
+
+    void Recorder::recordTick() {
+        recordEntry(RECORD_TICK, 0, "");
+    }
+
+    void Recorder::recordInvoke(const std::string& name, const Arguments& args) {
+        std::string data;
+        writeString(data, name);
+        for (const auto& arg : args)
+            writeString(data, arg);
+
+        recordEntry(RECORD_INVOKE, INTERNAL, data);
+    }
+
+    void Recorder::recordLoad(unsigned short runningFrom, const std::string& path, unsigned long long id) {
+        std::string data;
+        writeVarint(data, id);
+        recordEntry(RECORD_LOAD, runningFrom, data + path);
+    }
+
+    void Parser::record(bool newInput, size_t statements, unsigned long long startedMicroseconds) {
+        if (!Recorder::isRecording())
+            return; // what was parsed stopped it
+
+        if (newInput && recordId == 0) {
+            recordEntry(RECORD_INPUT, pLexer->ctx.runningFrom, pLexer->getInput(), startedMicroseconds);
+            return;
+        }
+
+        std::string data;
+        writeVarint(data, recordId);
+        writeVarint(data, statements);
+        if (newInput)
+            data += pLexer->getInput();
+
+        recordEntry(newInput ? RECORD_PARSE_INPUT : RECORD_RESUME, pLexer->ctx.runningFrom, data, startedMicroseconds);
+    }
+
+    /// @brief runs an entry of replayRecording
+    /// @param states the ones the host resumed, by their id
+    static void replayEntry(unsigned char type, CommandContext& ctx, const std::string& data, std::unordered_map<unsigned long long, ParserState>& states, std::unordered_map<std::string, std::string>* pVariables) {
+        size_t position = 0;
+        unsigned long long id = 0, statements = 0;
+
+        if (type == RECORD_INPUT) {
+            Lexer lexer{ctx, data};
+            Parser(&lexer, pVariables).parse();
+        } else if (type == RECORD_EXEC)
+            execConfigFile(ctx, data, pVariables);
+        else if (type == RECORD_TICK)
+            Scheduler::tick(pVariables);
+        else if (type == RECORD_INVOKE) {
+            _InvokeScope scope;
+            std::string name, arg;
+            if (!readString(data, position, name))
+                return;
+
+            while (readString(data, position, arg))
+                scope.ctx.args.push_back(arg);
+
+            CommandHandle handle(name);
+            _invoke(handle, scope.ctx);
+        } else if (type == RECORD_LOAD) {
+            if (readVarint(data, position, id) && !loadConfigFile(ctx, data.substr(position), states[id]))
+                printf(OutputLevel::_ERROR, "could not load file \"{}\"\n", data.substr(position));
+        } else if (type == RECORD_PARSE_INPUT) {
+            if (!readVarint(data, position, id) || !readVarint(data, position, statements))
+                return;
+
+            Lexer lexer{ctx, data.substr(position)};
+            if (Parser(&lexer, pVariables).parse(states[id], statements))
+                states.erase(id);
+        } else if (type == RECORD_RESUME) {
+            if (!readVarint(data, position, id) || !readVarint(data, position, statements))
+                return;
+
+            auto it = states.find(id);
+            if (it == states.end())
+                print(OutputLevel::_ERROR, "recording resumes a state it did not load\n");
+            else if (Parser(it->second, pVariables).parse(it->second, statements))
+                states.erase(it);
+        }
+    }
+
+    bool replayRecording(const std::string& path, std::unordered_map<std::string, std::string>* pVariables, bool paced, ReplayStats& statsOut) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+
+        std::string content = readStream(file);
+        if (content.compare(0, recordingMagic.size(), recordingMagic) != 0)
+            return false;
+
+        statsOut = ReplayStats();
+        std::vector<double> latencies;
+        unsigned long long commandsBefore = Command::getRunCount();
+        unsigned long long recordedMicroseconds = 0;
+        std::unordered_map<unsigned long long, ParserState> states;
+        auto start = std::chrono::steady_clock::now();
+
+        size_t position = recordingMagic.size();
+        while (position < content.size()) {
+            unsigned char type = static_cast<unsigned char>(content[position++]);
+            unsigned long long runningFrom, microseconds;
+            std::string data;
+            if (!readVarint(content, position, runningFrom) || !readVarint(content, position, microseconds) || !readString(content, position, data)) {
+                print(OutputLevel::_ERROR, "recording is cut short\n");
+                break;
+            }
+
+            recordedMicroseconds += microseconds;
+            if (paced)
+                std::this_thread::sleep_until(start + std::chrono::microseconds(recordedMicroseconds));
+
+            CommandContext ctx;
+            ctx.runningFrom = static_cast<unsigned short>(runningFrom);
+            auto entryStart = std::chrono::steady_clock::now();
+            replayEntry(type, ctx, data, states, pVariables);
+
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - entryStart).count());
+        }
+
+        statsOut.entries = latencies.size();
+        statsOut.commands = Command::getRunCount() - commandsBefore;
+        statsOut.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (!latencies.empty()) {
+            std::sort(latencies.begin(), latencies.end());
+            auto percentile = [&latencies](double p) {
+                return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+            };
+
+            statsOut.p50 = percentile(0.5);
+            statsOut.p90 = percentile(0.9);
+            statsOut.p99 = percentile(0.99);
+            statsOut.max = latencies.back();
+        }
+
+        return true;
+    }
+
+    MemoryUsage Memory::usages[MEMORY_SUBSYSTEM_COUNT];
+    MemoryUsage Memory::total;
+    std::atomic<size_t> Memory::lexerCount{0};
+    std::atomic<size_t> Memory::lexerBytes{0};
+    std::atomic<size_t> Memory::lexerAllocations{0};
+    std::atomic<size_t> Memory::peakLexerBytes{0};
+    std::atomic<size_t> Memory::peakLexerAllocations{0};
+
+    /*
+     * The sizes are estimates of what the standard containers allocate: a vector holds one block of capacity elements,
+     * a hash container one block of buckets and one node per element, each with the element, the next pointer and the hash.
+     */
+
+    static void addBlock(MemoryUsage& usage, size_t bytes) {
+        if (bytes == 0)
+            return;
+
+        usage.bytes += bytes;
+        ++usage.allocations;
+    }
+
+    static void addString(MemoryUsage& usage, const std::string& string) {
+        addBlock(usage, Memory::getHeapBytes(string));
+    }
+
+    template<typename T, typename VectorAllocator>
+    static void addVector(MemoryUsage& usage, const std::vector<T, VectorAllocator>& vector) {
+        addBlock(usage, vector.capacity() * sizeof(T));
+    }
+
+    static void addStrings(MemoryUsage& usage, const std::vector<std::string>& strings) {
+        addVector(usage, strings);
+        for (const auto& string : strings)
+            addString(usage, string);
+    }
+
+    template<typename HashContainer>
+    static void addHashContainer(MemoryUsage& usage, const HashContainer& container) {
+        addBlock(usage, container.bucket_count() > 1 ? container.bucket_count() * sizeof(void*) : 0);
+        for (size_t i = 0; i < container.size(); ++i)
+            addBlock(usage, sizeof(typename HashContainer::value_type) + sizeof(void*) + sizeof(size_t));
+    }
+
+    static void updatePeak(MemoryUsage& usage) {
+        usage.peakBytes = std::max(usage.peakBytes, usage.bytes);
+        usage.peakAllocations = std::max(usage.peakAllocations, usage.allocations);
+    }
+
+    static void updatePeak(std::atomic<size_t>& peak, size_t value) {
+        size_t current = peak.load(std::memory_order_relaxed);
+        while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+
+    void Memory::measure(const std::unordered_map<std::string, std::string>* pVariables) {
+        MemoryUsage measured[MEMORY_SUBSYSTEM_COUNT];
+
+        MemoryUsage& commands = measured[MEMORY_COMMANDS];
+        commands.count = Command::commands.size();
+        addVector(commands, Command::commands);
+        for (const auto& command : Command::commands)
+            addString(commands, command.name);
+        addStrings(commands, commandUsages);
+        addHashContainer(commands, commandTableUsages);
+        for (const auto& pair : commandTableUsages)
+            addString(commands, pair.second);
+        addVector(commands, commandUsageGenerations);
+        addVector(commands, freeCommandUsages);
+
+        MemoryUsage& cvars = measured[MEMORY_CVARS];
+        cvars.count = CVARStorage::cvars.size();
+        addHashContainer(cvars, CVARStorage::cvars);
+        for (const auto& pair : CVARStorage::cvars)
+            addString(cvars, pair.first);
+        addStrings(cvars, CVARStorage::pendingCvars);
+        addStrings(cvars, CVARStorage::dirtyCvars);
+        addStrings(cvars, CVARStorage::unsavedCvars);
+        addString(cvars, CVARStorage::archivePath);
+
+        MemoryUsage& variables = measured[MEMORY_VARIABLES];
+        if (pVariables != nullptr) {
+            variables.count = pVariables->size();
+            addHashContainer(variables, *pVariables);
+            for (const auto& pair : *pVariables) {
+                addString(variables, pair.first);
+                addString(variables, pair.second);
+            }
+        }
+        addStrings(variables, loopAliasesRunning);
+        addStrings(variables, toggleTypesRunning);
+
+        MemoryUsage& aliasGraph = measured[MEMORY_ALIAS_GRAPH];
+        aliasGraph.count = AliasGraph::references.size();
+        addHashContainer(aliasGraph, AliasGraph::references);
+        for (const auto& pair : AliasGraph::references) {
+            addString(aliasGraph, pair.first);
+            addStrings(aliasGraph, pair.second);
+        }
+        addHashContainer(aliasGraph, AliasGraph::callers);
+        for (const auto& pair : AliasGraph::callers) {
+            addString(aliasGraph, pair.first);
+            addHashContainer(aliasGraph, pair.second);
+            for (const auto& caller : pair.second)
+                addString(aliasGraph, caller);
+        }
+
+        MemoryUsage& scheduler = measured[MEMORY_SCHEDULER];
+        for (const auto* pTasks : {&Scheduler::frameTasks, &Scheduler::timerTasks}) {
+            scheduler.count += pTasks->size();
+            addVector(scheduler, *pTasks);
+            for (const auto& task : *pTasks) {
+                addVector(scheduler, task.state.lexers);
+                addVector(scheduler, task.state.runningAliases);
+                for (const auto& runningAlias : task.state.runningAliases)
+                    addString(scheduler, runningAlias.first);
+            }
+        }
+
+        measured[MEMORY_LEXERS] = getUsage(MEMORY_LEXERS);
+
+        MemoryUsage measuredTotal;
+        for (unsigned char i = 0; i < MEMORY_SUBSYSTEM_COUNT; ++i) {
+            measured[i].peakBytes = usages[i].peakBytes;
+            measured[i].peakAllocations = usages[i].peakAllocations;
+            updatePeak(measured[i]);
+            usages[i] = measured[i];
+
+            measuredTotal.count += measured[i].count;
+            measuredTotal.bytes += measured[i].bytes;
+            measuredTotal.allocations += measured[i].allocations;
+        }
+
+        measuredTotal.peakBytes = total.peakBytes;
+        measuredTotal.peakAllocations = total.peakAllocations;
+        updatePeak(measuredTotal);
+        total = measuredTotal;
+    }
+
+    MemoryUsage Memory::getUsage(MemorySubsystem subsystem) {
+        if (subsystem != MEMORY_LEXERS)
+            return usages[subsystem];
+
+        MemoryUsage usage;
+        usage.count = lexerCount.load(std::memory_order_relaxed);
+        usage.bytes = lexerBytes.load(std::memory_order_relaxed);
+        usage.allocations = lexerAllocations.load(std::memory_order_relaxed);
+        usage.peakBytes = peakLexerBytes.load(std::memory_order_relaxed);
+        usage.peakAllocations = peakLexerAllocations.load(std::memory_order_relaxed);
+        return usage;
+    }
+
+    MemoryUsage Memory::getTotal() {
+        return total;
+    }
+
+    const char* Memory::getName(MemorySubsystem subsystem) {
+        static const char* names[MEMORY_SUBSYSTEM_COUNT] = {"commands", "cvars", "variables", "alias graph", "scheduler", "lexers"};
+        return subsystem < MEMORY_SUBSYSTEM_COUNT ? names[subsystem] : "unknown";
+    }
+
+    void Memory::resetPeaks() {
+        for (auto& usage : usages) {
+            usage.peakBytes = usage.bytes;
+            usage.peakAllocations = usage.allocations;
+        }
+
+        total.peakBytes = total.bytes;
+        total.peakAllocations = total.allocations;
+        peakLexerBytes = lexerBytes.load();
+        peakLexerAllocations = lexerAllocations.load();
+    }
+
+    size_t Memory::getHeapBytes(const std::string& string) {
+        const char* pData = string.data();
+        const char* pObject = reinterpret_cast<const char*>(&string);
+        if (!std::less<const char*>()(pData, pObject) && std::less<const char*>()(pData, pObject + sizeof(string)))
+            return 0; // small string, kept inline
+
+        return string.capacity() + 1;
+    }
+
+    void Memory::addLexer(size_t bytes) {
+        lexerCount.fetch_add(1, std::memory_order_relaxed);
+        if (bytes == 0)
+            return;
+
+        updatePeak(peakLexerBytes, lexerBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+        updatePeak(peakLexerAllocations, lexerAllocations.fetch_add(1, std::memory_order_relaxed) + 1);
+    }
+
+    void Memory::removeLexer(size_t bytes) {
+        lexerCount.fetch_sub(1, std::memory_order_relaxed);
+        if (bytes == 0)
+            return;
+
+        lexerBytes.fetch_sub(bytes, std::memory_order_relaxed);
+        lexerAllocations.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    LexerMemory::LexerMemory(size_t bytes) : bytes(bytes) {
+        Memory::addLexer(bytes);
+    }
+
+    LexerMemory::LexerMemory(const LexerMemory& other) : bytes(other.bytes) {
+        Memory::addLexer(bytes);
+    }
+
+    LexerMemory::LexerMemory(LexerMemory&& other) noexcept : bytes(other.bytes) {
+        // the input moves with it
+        other.bytes = 0;
+        Memory::addLexer(0);
+    }
+
+    LexerMemory& LexerMemory::operator=(LexerMemory other) noexcept {
+        std::swap(bytes, other.bytes);
+        return *this;
+    }
+
+    LexerMemory::~LexerMemory() {
+        Memory::removeLexer(bytes);
+    }
+
+    void LexerMemory::resize(size_t newBytes) {
+        if (newBytes == bytes)
+            return;
+
+        Memory::removeLexer(bytes);
+        Memory::addLexer(newBytes);
+        bytes = newBytes;
     }
-}
\ No newline at end of file
+}
@@ -24,9 +24,19 @@
  * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <limits>
+#include <type_traits>
 #include <sstream>
+#include <atomic>
 #include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <stdexcept>
 #include <vector>
+#include <initializer_list>
+#include <memory>
 
 namespace SweatCI {
     enum TokenType {
@@ -67,22 +77,25 @@ namespace SweatCI {
 
     std::string tokenTypeToString(const TokenType& type);
 
+    /// @note copy and move are the compiler generated ones, moving a token only moves its string
     class Token {
     public:
-        Token(const Token& other);
-        Token();
-        ~Token();
-
+        Token() = default;
         Token(const TokenType& type, const std::string& value);
+        Token(const TokenType& type, std::string&& value);
+
         const TokenType& getType() const;
-        const std::string& getValue();
+        const std::string& getValue() const;
         std::string string() const;
 
-        Token& operator=(const Token& other);
-
     private:
+        /// @brief keeps the memory of the last value
+        void set(TokenType newType, const char* pValue, size_t size);
+
         TokenType type = TokenType::NOTHING;
         std::string value = "";
+
+        friend class Lexer;
     };
 
     enum OutputLevel {
@@ -114,20 +127,85 @@ namespace SweatCI {
         LOOP_ALIAS = 2, // an active loop alias
         FILE = 4, // exec command is used
         CONSOLE = 8, // user types manually on console
-        INTERNAL = 16 // a function(NOT COMMAND) calls a command or something like that. This means that this flag probably will never be used with the others
+        INTERNAL = 16, // a function(NOT COMMAND) calls a command or something like that. This means that this flag probably will never be used with the others
+        REMOTE = 32 // sent by a remote console client, see rcon/SweatCI_rcon.h
 #ifdef SWEATCI_COMMAND_RUNNING_FROM_EXTRA
         ,SWEATCI_COMMAND_RUNNING_FROM_EXTRA
 #endif
     };
 
+    /// @brief works like a std::vector<std::string> but keeps the first arguments inline
+    /// @note clearing keeps the strings allocated, so reusing it for the next statement usually does not allocate
+    /// @note it is not a std::vector, code that needs one can copy it through the conversion below
+    class Arguments {
+    public:
+        typedef std::string* iterator;
+        typedef const std::string* const_iterator;
+
+        static constexpr size_t inlineCapacity = 4;
+
+        Arguments() {}
+        Arguments(std::initializer_list<std::string> arguments);
+        Arguments(const std::vector<std::string>& arguments);
+        Arguments(const Arguments& other);
+        Arguments& operator=(const Arguments& other);
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        std::string& operator[](size_t index) { return pData[index]; }
+        const std::string& operator[](size_t index) const { return pData[index]; }
+        /// @throws std::out_of_range if index is not less than size()
+        std::string& at(size_t index);
+        const std::string& at(size_t index) const;
+        std::string& front() { return pData[0]; }
+        const std::string& front() const { return pData[0]; }
+        std::string& back() { return pData[count-1]; }
+        const std::string& back() const { return pData[count-1]; }
+
+        iterator begin() { return pData; }
+        iterator end() { return pData + count; }
+        const_iterator begin() const { return pData; }
+        const_iterator end() const { return pData + count; }
+
+        std::string* data() { return pData; }
+        const std::string* data() const { return pData; }
+
+        void push_back(const std::string& argument);
+        void push_back(std::string&& argument);
+        /// @return an empty string at the end
+        std::string& emplace_back();
+        void pop_back();
+        /// @return where argument is now
+        iterator insert(const_iterator position, const std::string& argument);
+        iterator insert(const_iterator position, std::string&& argument);
+        /// @return what came after the erased arguments
+        iterator erase(const_iterator position);
+        iterator erase(const_iterator first, const_iterator last);
+        void resize(size_t newCount);
+        void clear();
+
+        operator std::vector<std::string>() const;
+
+    private:
+        /// @brief makes room for one more argument without clearing it
+        std::string& nextSlot();
+
+        std::string inlineArguments[inlineCapacity];
+        std::vector<std::string> heapArguments; // used when there are more than inlineCapacity arguments
+        std::string* pData = inlineArguments;
+        size_t count = 0;
+    };
+
     struct CommandContext {
-        std::vector<std::string> args{};
+        Arguments args{};
 
         Command* pCommand = nullptr;
 
         std::string filePath = "";
         unsigned short runningFrom; // see CommandRunningFrom
         size_t lineIndex = 0, columnIndex = 0, lineCount = 0;
+        unsigned long long sourceId = 0; // tells apart sources of the same kind, like remote console clients, for RateLimiter
     };
 
     typedef void(*CommandCallback)(CommandContext& ctx);
@@ -144,24 +222,36 @@ namespace SweatCI {
         static const std::vector<Command>& getCommands();
         
         static void printUsage(const Command &command);
+
+        /// @note usages are kept apart from the commands, so finding and running them does not bring the text into cache
+        /// @warning a copy of a registered command has no usage anymore once the command is deleted or Command::clear is called
+        const std::string& getUsage() const;
         
         /// @return 1 if success
         static bool deleteCommand(const std::string& commandName);
 
         static void clear();
+
+        /// @return how many times any command was run
+        static unsigned long long getRunCount();
         
         void run(CommandContext& ctx);
 
-        std::string name = "";
-        std::string usage = "";
+        // what running it needs comes first, the name is only read to find it
+        CommandCallback callback = nullptr;
+        void* pData = nullptr;
 
         unsigned char minArgs = 0;
         unsigned char maxArgs = 0;
-        
-        CommandCallback callback = nullptr;
-        void* pData = nullptr;
+        unsigned short usageGeneration = 0; // the slot at usageIndex belongs to this command only while its generation is the same
+        unsigned int usageIndex = static_cast<unsigned int>(-1); // see getUsage, only given to commands that were registered
+
+        std::string name = "";
+        std::shared_ptr<const std::string> pPendingUsage{}; // the usage of a command that is not registered yet
+        const char* pTableUsage = nullptr; // the usage of a command registered from a CommandTable, which outlives it
 
         static std::vector<Command> commands;
+        static unsigned long long runCount;
     };
 
     void registerCommand(const std::string& name, unsigned char minArgs, unsigned char maxArgs,
@@ -169,6 +259,410 @@ namespace SweatCI {
 
     void registerCommand(const Command& command);
 
+    /// @brief a command known at build time, see CommandTable
+    struct CommandDefinition {
+        const char* name;
+        unsigned char minArgs;
+        unsigned char maxArgs;
+        CommandCallback callback;
+        const char* usage;
+    };
+
+    /// @warning this function is not meant to be used outside this header
+    constexpr unsigned long long _hashName(const char* pName, size_t length) {
+        // FNV-1a and a final mix, so the high and low bits can be used separately
+        unsigned long long hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= static_cast<unsigned char>(pName[i]);
+            hash *= 1099511628211ULL;
+        }
+
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    /// @warning this function is not meant to be used outside this header
+    constexpr size_t _nameLength(const char* pName) {
+        size_t length = 0;
+        while (pName[length] != '\0')
+            ++length;
+
+        return length;
+    }
+
+    /// @warning this function is not meant to be used outside this header
+    constexpr size_t _nextPowerOfTwo(size_t value) {
+        size_t power = 1;
+        while (power < value)
+            power *= 2;
+
+        return power;
+    }
+
+    /*
+     * Commands known at build time with a perfect hash made at compile time: names are split into buckets and
+     * each bucket gets the displacement that puts all its names into free slots, so finding a name is one hash,
+     * two table reads and one comparison.
+     * static constexpr SweatCI::CommandDefinition commands[] = {{"jump", 0, 0, jump, "- jumps"}, {"say", 1, 1, say, "<message>"}};
+     * static constexpr SweatCI::CommandTable<2> commandTable(commands);
+     * Repeated names do not compile.
+     */
+    template<size_t N>
+    class CommandTable {
+    public:
+        static_assert(N > 0 && N < 65535, "a CommandTable must have between 1 and 65534 commands");
+
+        static constexpr size_t slotCount = _nextPowerOfTwo(N * 2);
+        static constexpr size_t bucketCount = N / 2 + 1;
+
+        constexpr CommandTable(const CommandDefinition (&definitions)[N]) : entries{}, displacements{}, slots{} {
+            unsigned long long hashes[N] = {};
+            size_t bucketStart[bucketCount + 1] = {};
+            size_t order[N] = {}; // entries sorted by bucket
+
+            for (size_t i = 0; i < N; ++i) {
+                entries[i] = definitions[i];
+                hashes[i] = _hashName(entries[i].name, _nameLength(entries[i].name));
+                ++bucketStart[bucket(hashes[i]) + 1];
+            }
+
+            size_t largestBucket = 0;
+            for (size_t i = 0; i < bucketCount; ++i) {
+                largestBucket = bucketStart[i+1] > largestBucket ? bucketStart[i+1] : largestBucket;
+                bucketStart[i+1] += bucketStart[i];
+            }
+
+            size_t filled[bucketCount] = {};
+            for (size_t i = 0; i < N; ++i) {
+                size_t b = bucket(hashes[i]);
+                order[bucketStart[b] + filled[b]++] = i;
+            }
+
+            // the largest buckets are placed first, while most slots are free
+            for (size_t size = largestBucket; size > 0; --size) {
+                for (size_t b = 0; b < bucketCount; ++b) {
+                    if (bucketStart[b+1] - bucketStart[b] != size)
+                        continue;
+
+                    unsigned int displacement = 0;
+                    while (!fits(hashes, order + bucketStart[b], size, displacement)) {
+                        if (++displacement == 65536)
+                            throw std::invalid_argument("CommandTable: names must be unique");
+                    }
+
+                    displacements[b] = static_cast<unsigned short>(displacement);
+                    for (size_t i = bucketStart[b]; i < bucketStart[b+1]; ++i)
+                        slots[slot(hashes[order[i]], displacement)] = static_cast<unsigned short>(order[i] + 1);
+                }
+            }
+        }
+
+        /// @return index of the only entry that can be name, -1 if none. The name still has to be compared
+        long find(const std::string& name) const {
+            unsigned long long hash = _hashName(name.data(), name.size());
+            return static_cast<long>(slots[slot(hash, displacements[bucket(hash)])]) - 1;
+        }
+
+        CommandDefinition entries[N];
+
+    private:
+        static constexpr size_t bucket(unsigned long long hash) {
+            return static_cast<size_t>(hash >> 40) % bucketCount;
+        }
+
+        static constexpr size_t slot(unsigned long long hash, unsigned int displacement) {
+            return static_cast<size_t>(hash + displacement * ((hash >> 20) | 1)) & (slotCount - 1);
+        }
+
+        constexpr bool fits(const unsigned long long* pHashes, const size_t* pOrder, size_t size, unsigned int displacement) const {
+            for (size_t i = 0; i < size; ++i) {
+                size_t s = slot(pHashes[pOrder[i]], displacement);
+                if (slots[s] != 0)
+                    return false;
+
+                for (size_t j = 0; j < i; ++j)
+                    if (slot(pHashes[pOrder[j]], displacement) == s)
+                        return false;
+            }
+
+            return true;
+        }
+
+        unsigned short displacements[bucketCount];
+        unsigned short slots[slotCount]; // entry index + 1, 0 if free
+    };
+
+    template<size_t N>
+    constexpr size_t CommandTable<N>::slotCount;
+    template<size_t N>
+    constexpr size_t CommandTable<N>::bucketCount;
+
+    /// @warning this function is not meant to be used outside this header
+    void _registerCommandTable(const CommandDefinition* pDefinitions, size_t count, void* pData, const void* pTable, long (*find)(const void* pTable, const std::string& name));
+
+    /// @brief registers every command in the table at once, they are then found through the table's perfect hash only
+    /// @note if a name is not valid or already exists the table is not used and its commands are found like any other
+    /// @param pData given to every command
+    /// @warning table must outlive the commands, it should be static constexpr
+    template<size_t N>
+    void registerCommands(const CommandTable<N>& table, void* pData = nullptr) {
+        _registerCommandTable(table.entries, N, pData, &table, [](const void* pTable, const std::string& name) {
+            return static_cast<const CommandTable<N>*>(pTable)->find(name);
+        });
+    }
+
+    /// @brief records when parsing, aliases, commands and file loading begin and end, to be exported as Chrome trace JSON
+    /// @note each thread writes into its own ring buffer without locking, so only the most recent events are kept.
+    /// Names and file paths are kept once per thread and the events point to them, so an event only hashes them
+    class Tracer {
+    public:
+        /// @brief clears everything recorded and starts recording
+        /// @note can be called while other threads are recording, they move to a new buffer on their next event
+        /// @param capacity amount of events each thread keeps
+        static void start(size_t capacity = 65536);
+        static void stop();
+
+        static bool isEnabled() {
+            return enabled.load(std::memory_order_relaxed);
+        }
+
+        /// @param pCtx if not nullptr, its file path and line are saved with the event
+        static void begin(const char* category, const std::string& name, const CommandContext* pCtx = nullptr);
+        static void end(const char* category);
+
+        /// @brief writes the events in a format that chrome://tracing and Perfetto can open
+        /// @warning should not be called while other threads are recording
+        static void exportChromeTrace(std::ostream& out);
+        /// @return false if could not open file
+        static bool exportChromeTrace(const std::string& path);
+
+    private:
+        static std::atomic<bool> enabled;
+    };
+
+    /// @brief begins an event when constructed and ends it when destroyed, if the Tracer is enabled
+    class TraceScope {
+    public:
+        TraceScope(const char* category, const std::string& name, const CommandContext* pCtx = nullptr);
+        ~TraceScope();
+
+    private:
+        const char* category;
+        bool active;
+    };
+
+    /// @brief records what the host gives the interpreter to run, so it can be replayed later
+    /// @note recorded are: input parsed straight from a Lexer(console, binds, Batch, rcon), invoke, loadConfigFile, execConfigFile(s),
+    /// Scheduler::tick and how many statements each budgeted parse ran, so parses split over frames are split the same way when replayed.
+    /// Whatever that runs(exec command, aliases, waits resumed) is not, replaying the outer one runs it again
+    /// @note not recorded are: resuming a ParserState the host built itself or got before start was called,
+    /// cvars and variables the host changes without the interpreter, and anything the callbacks do on their own
+    /// @warning everything recorded has to run on one thread
+    class Recorder {
+    public:
+        /// @brief starts writing to path, replacing it
+        /// @return false if could not open file
+        static bool start(const std::string& path);
+        static void stop();
+
+        static bool isRecording() {
+            return recording;
+        }
+
+        static void recordInput(unsigned short runningFrom, const std::string& input);
+        static void recordExec(unsigned short runningFrom, const std::string& path);
+        static void recordTick();
+        static void recordInvoke(const std::string& name, const Arguments& args);
+        static void recordLoad(unsigned short runningFrom, const std::string& path, unsigned long long id);
+
+    private:
+        static bool recording;
+    };
+
+    struct ReplayStats {
+        size_t entries = 0;
+        unsigned long long commands = 0; // times Command::run was called
+        double seconds = 0;
+
+        // microseconds each entry took to run
+        double p50 = 0;
+        double p90 = 0;
+        double p99 = 0;
+        double max = 0;
+    };
+
+    /// @brief runs what the Recorder saved to path again
+    /// @param paced if true, each entry waits for the time it was recorded at, otherwise they run back to back.
+    /// Frames are not waited for, the recorded Scheduler::tick calls advance them
+    /// @return false if could not read file or it is not a recording
+    bool replayRecording(const std::string& path, std::unordered_map<std::string, std::string>* pVariables, bool paced, ReplayStats& statsOut);
+
+    enum QuotaAction : unsigned char {
+        QUOTA_DROP = 0, // the statement is skipped
+        QUOTA_DEFER // the Parser stops and tries again on the next Scheduler::tick
+    };
+
+    enum QuotaScope : unsigned char {
+        QUOTA_SHARED = 0, // one bucket for every command from the source
+        QUOTA_PER_ID, // one bucket for each CommandContext::sourceId
+        QUOTA_PER_FILE // one bucket for each CommandContext::filePath
+    };
+
+    struct QuotaCounters {
+        unsigned long long admitted = 0;
+        unsigned long long deferred = 0;
+        unsigned long long dropped = 0;
+    };
+
+    /*
+     * Token bucket quotas for commands, keyed by where they are running from. Each command takes one token from the
+     * bucket of every quota whose source is in its runningFrom, and tokens come back at a fixed rate up to the burst.
+     * A command that finds one of them empty is dropped or deferred, dropping wins if both apply.
+     * Deferring stops the whole Parser, so a source that keeps sending input(like a loop alias) piles up tasks and is
+     * better dropped.
+     */
+    class RateLimiter {
+    public:
+        /// @param source one of CommandRunningFrom, replaces its quota if it already has one
+        /// @param commandsPerSecond how fast tokens come back
+        /// @param burst how many tokens a bucket holds, it starts full
+        static void setQuota(unsigned short source, double commandsPerSecond, double burst, QuotaAction action = QUOTA_DROP, QuotaScope scope = QUOTA_SHARED);
+        static void removeQuota(unsigned short source);
+        static void clear();
+
+        /// @return false if source has no quota
+        static bool getCounters(unsigned short source, QuotaCounters& countersOut);
+
+        /// @brief forgets the bucket of a sourceId that will not be used again, like a client that disconnected
+        static void forgetSource(unsigned short source, unsigned long long sourceId);
+
+        /// @return true if the command can run, otherwise actionOut is what should be done with it
+        static bool admit(const CommandContext& ctx, QuotaAction& actionOut) {
+            return (limitedSources & ctx.runningFrom) == 0 || admitLimited(ctx, actionOut);
+        }
+
+    private:
+        static bool admitLimited(const CommandContext& ctx, QuotaAction& actionOut);
+
+        static unsigned short limitedSources; // every source with a quota
+    };
+
+    /// @brief where the interpreter gets the memory it allocates itself from: the registries and the lexers of the aliases running
+    /// @note allocate must return memory aligned like malloc does
+    struct Allocator {
+        void* (*allocate)(void* pData, size_t size) = nullptr;
+        void (*deallocate)(void* pData, void* pMemory, size_t size) = nullptr;
+        void* pData = nullptr;
+    };
+
+    /// @brief replaces the default allocator(operator new and delete)
+    /// @note should be called at init, before anything is registered or run
+    /// @return false if memory from the current allocator is still in use, nothing is changed then
+    bool setAllocator(const Allocator& allocator);
+    const Allocator& getAllocator();
+
+    /// @warning this function is not meant to be used outside this header
+    void* _allocate(size_t size);
+    /// @warning this function is not meant to be used outside this header
+    void _deallocate(void* pMemory, size_t size);
+
+    /// @brief standard allocator that uses the Allocator given to setAllocator
+    template<typename T>
+    struct HostAllocator {
+        typedef T value_type;
+
+        HostAllocator() {}
+        template<typename U>
+        HostAllocator(const HostAllocator<U>&) {}
+
+        T* allocate(size_t count) {
+            return static_cast<T*>(_allocate(count * sizeof(T)));
+        }
+
+        void deallocate(T* pMemory, size_t count) {
+            _deallocate(pMemory, count * sizeof(T));
+        }
+
+        template<typename U>
+        bool operator==(const HostAllocator<U>&) const { return true; }
+        template<typename U>
+        bool operator!=(const HostAllocator<U>&) const { return false; }
+    };
+
+    template<typename Key, typename Value>
+    using HostMap = std::unordered_map<Key, Value, std::hash<Key>, std::equal_to<Key>, HostAllocator<std::pair<const Key, Value>>>;
+
+    enum MemorySubsystem : unsigned char {
+        MEMORY_COMMANDS = 0, // Command::commands with their names and usages
+        MEMORY_CVARS, // CVARStorage
+        MEMORY_VARIABLES, // the variables map(aliases and variables) and the aliases running
+        MEMORY_ALIAS_GRAPH,
+        MEMORY_SCHEDULER, // tasks waiting, their lexers are counted in MEMORY_LEXERS
+        MEMORY_LEXERS, // every Lexer alive and the copy of the input it keeps
+        MEMORY_SUBSYSTEM_COUNT
+    };
+
+    struct MemoryUsage {
+        size_t count = 0; // commands, cvars, variables, aliases, tasks or lexers
+        size_t bytes = 0;
+        size_t allocations = 0;
+        size_t peakBytes = 0;
+        size_t peakAllocations = 0;
+    };
+
+    /// @brief estimates how much heap memory the interpreter holds
+    /// @note lexers are counted as they are created and destroyed, the rest only when Memory::measure is called,
+    /// so their peaks are the highest measured
+    class Memory {
+    public:
+        /// @brief walks every registry and updates their usage and peaks
+        /// @note called by mem_stats and at the end of the outermost exec
+        static void measure(const std::unordered_map<std::string, std::string>* pVariables);
+
+        static MemoryUsage getUsage(MemorySubsystem subsystem);
+        /// @return usage of every subsystem added up, its peak is the highest total measured
+        static MemoryUsage getTotal();
+        static const char* getName(MemorySubsystem subsystem);
+
+        /// @brief sets every peak to the current usage
+        static void resetPeaks();
+
+        /// @return heap bytes the string holds, 0 if it fits inside the std::string itself
+        static size_t getHeapBytes(const std::string& string);
+
+        static void addLexer(size_t bytes);
+        static void removeLexer(size_t bytes);
+
+    private:
+        static MemoryUsage usages[MEMORY_SUBSYSTEM_COUNT];
+        static MemoryUsage total;
+
+        // lexers are created by the threads loading files too
+        static std::atomic<size_t> lexerCount;
+        static std::atomic<size_t> lexerBytes;
+        static std::atomic<size_t> lexerAllocations;
+        static std::atomic<size_t> peakLexerBytes;
+        static std::atomic<size_t> peakLexerAllocations;
+    };
+
+    /// @brief counts the input a Lexer keeps into Memory for as long as the Lexer lives
+    class LexerMemory {
+    public:
+        LexerMemory(size_t bytes = 0);
+        LexerMemory(const LexerMemory& other);
+        LexerMemory(LexerMemory&& other) noexcept;
+        LexerMemory& operator=(LexerMemory other) noexcept;
+        ~LexerMemory();
+
+        /// @brief the input was replaced by one with this many heap bytes
+        void resize(size_t newBytes);
+
+    private:
+        size_t bytes; // 0 once moved from
+    };
+
     namespace BaseCommands {
         void init(std::unordered_map<std::string, std::string>* variables);
 
@@ -181,6 +675,9 @@ namespace SweatCI {
         void incrementvar(CommandContext& ctx);
         void exec(CommandContext& ctx);
         void toggle(CommandContext& ctx);
+        void wait(CommandContext& ctx);
+        void after(CommandContext& ctx);
+        void memStats(CommandContext& ctx);
     };
 
     class Lexer {
@@ -188,44 +685,172 @@ namespace SweatCI {
         Lexer(const CommandContext& ctx, const std::string& input);
 
         Token nextToken();
+        /// @brief same as nextToken, but writes into tokenOut, reusing the memory of its value
+        void nextToken(Token& tokenOut);
+        const std::string& getInput() const;
+
+        /// @brief starts over with another input, reusing the memory of the last one
+        void reset(const CommandContext& ctx, const char* pInput, size_t size);
 
         CommandContext ctx;
     private:
         /// @note skips newline
         /// @return true if is newline
         bool nextPosition();
+        /// @brief same as calling nextPosition until newPosition
+        /// @warning there can't be a newline before newPosition
+        void skipTo(size_t newPosition);
         bool isCommand(const std::string& commandName);
-        Token parseToken();
-        Token parseString();
+        void parseToken(Token& tokenOut);
+        void parseString(Token& tokenOut);
 
         std::string input;
+        LexerMemory memory;
         size_t position = 0;
-        Token lastToken;
+        TokenType lastTokenType = TokenType::NOTHING;
     };
 
+    /// @warning this function is not meant to be used outside this header
     template<typename T>
-    std::string numberToString(T value) {
-        std::string str = std::to_string(value);
-        std::stringstream out;
-
-        for (size_t i = 0; i < str.size(); ++i) {
-            if (str[i] == '.') {
-                while (str.back() == '0') {
-                    str.pop_back();
-                    if (str.back() == '.') {
-                        str.pop_back();
-                        break;
-                    }
-                }
-            }
+    std::string _numberToString(T value, std::true_type /* is integral */) {
+        typedef typename std::make_unsigned<T>::type Unsigned;
+
+        // digits are written backwards from the end of the buffer
+        char buffer[24];
+        char* pStart = buffer + sizeof(buffer);
+        bool negative = value < static_cast<T>(0);
+        Unsigned magnitude = negative ? static_cast<Unsigned>(0 - static_cast<Unsigned>(value)) : static_cast<Unsigned>(value);
+
+        do {
+            *--pStart = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude != 0);
+
+        if (negative)
+            *--pStart = '-';
+
+        return std::string(pStart, buffer + sizeof(buffer));
+    }
+
+    /// @warning this function is not meant to be used outside this header
+    inline void _formatFloatingPoint(char* buffer, size_t size, int precision, double value) {
+        std::snprintf(buffer, size, "%.*g", precision, value);
+    }
+
+    /// @warning this function is not meant to be used outside this header
+    inline void _formatFloatingPoint(char* buffer, size_t size, int precision, long double value) {
+        std::snprintf(buffer, size, "%.*Lg", precision, value);
+    }
+
+    /// @warning this function is not meant to be used outside this header
+    inline float _readFloatingPoint(const char* text, float) {
+        return std::strtof(text, nullptr);
+    }
+
+    /// @warning this function is not meant to be used outside this header
+    inline double _readFloatingPoint(const char* text, double) {
+        return std::strtod(text, nullptr);
+    }
+
+    /// @warning this function is not meant to be used outside this header
+    inline long double _readFloatingPoint(const char* text, long double) {
+        return std::strtold(text, nullptr);
+    }
 
-            out << str[i];
+    /// @warning this function is not meant to be used outside this header
+    template<typename T>
+    std::string _numberToString(T value, std::false_type /* is integral */) {
+        static_assert(std::is_floating_point<T>::value, "numberToString only converts numbers");
+        typedef typename std::conditional<std::is_same<T, long double>::value, long double, double>::type Formatted;
+
+        // every number with up to digits10 digits reads back as itself, so the first precision that reads back is the shortest
+        char buffer[64];
+        for (int precision = std::numeric_limits<T>::digits10; ; ++precision) {
+            _formatFloatingPoint(buffer, sizeof(buffer), precision, static_cast<Formatted>(value));
+
+            if (precision >= std::numeric_limits<T>::max_digits10 || _readFloatingPoint(buffer, value) == value)
+                break;
         }
 
-        return out.str();
+        return buffer;
+    }
+
+    /// @return the shortest text that reads back as the same value, "1.5", "696969.696969" or "1e+20"
+    template<typename T>
+    std::string numberToString(T value) {
+        return _numberToString(value, std::is_integral<T>());
+    }
+
+    /// @brief a command looked up once by invoke, and again only if commands were deleted since then
+    struct CommandHandle {
+        CommandHandle(const std::string& name) : name(name) {}
+
+        std::string name;
+        size_t index = static_cast<size_t>(-1); // in Command::commands
+        unsigned long long generation = 0;
+    };
+
+    /// @brief lends a context with runningFrom INTERNAL to one invoke, nested invokes get their own
+    /// @warning this class is not meant to be used outside this header
+    class _InvokeScope {
+    public:
+        _InvokeScope();
+        ~_InvokeScope();
+        _InvokeScope(const _InvokeScope&) = delete;
+
+        CommandContext& ctx;
+    };
+
+    /// @warning this function is not meant to be used outside this header
+    bool _invoke(CommandHandle& handle, CommandContext& ctx);
+
+    /// @warning this function is not meant to be used outside this header
+    inline void _appendArgument(Arguments& arguments, const std::string& value) {
+        arguments.push_back(value);
+    }
+
+    /// @warning this function is not meant to be used outside this header
+    inline void _appendArgument(Arguments& arguments, const char* value) {
+        arguments.emplace_back() = value;
+    }
+
+    /// @warning this function is not meant to be used outside this header
+    inline void _appendArgument(Arguments& arguments, bool value) {
+        arguments.emplace_back() = value ? "1" : "0";
+    }
+
+    /// @warning this function is not meant to be used outside this header
+    template<typename T>
+    void _appendArgument(Arguments& arguments, T value) {
+        static_assert(std::is_arithmetic<T>::value, "invoke only takes strings, bools and numbers as arguments");
+        arguments.push_back(numberToString(value));
+    }
+
+    /// @brief runs a command from the host without lexing or parsing anything, like invoke(handle, "5") instead of parsing "t_int 5"
+    /// @note runningFrom is INTERNAL and the arguments are checked like the parser does, but they are not rate limited
+    /// @note there is no Parser to stop, so wait does nothing
+    /// @return true if the command ran, if it does not exist or the arguments are out of its range the reason is printed
+    template<typename... Args>
+    bool invoke(CommandHandle& handle, const Args&... args) {
+        _InvokeScope scope;
+        int expand[] = {0, (_appendArgument(scope.ctx.args, args), 0)...};
+        (void)expand;
+
+        return _invoke(handle, scope.ctx);
+    }
+
+    /// @brief same as above, but the command is looked up every time
+    template<typename... Args>
+    bool invoke(const std::string& name, const Args&... args) {
+        CommandHandle handle(name);
+        return invoke(handle, args...);
     }
 
     namespace Utils {
+        /// @return true if name can be used for a command, cvar or variable
+        /// @note a name can not be empty nor have whitespaces, control characters, ';' or '"'
+        bool isValidName(const std::string& name);
+
         namespace Command {
             bool getBoolean(const std::string& str, bool& out);
             bool getFloat(const std::string& str, float& out);
@@ -273,12 +898,133 @@ namespace SweatCI {
             _MAKE_CVARUTILS_DEFINITIONS(Bit14UnsignedShort)
             _MAKE_CVARUTILS_DEFINITIONS(Bit15UnsignedShort)
             _MAKE_CVARUTILS_DEFINITIONS(Bit16UnsignedShort)
+
+            /// @brief sets bit index(0 is the lowest) of the integer at pData, if value is above 0 it is set, otherwise cleared
+            /// @note values that are not numbers are ignored
+            template<typename T, unsigned int index>
+            void setBit(void* pData, const std::string& value) {
+                static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value && index < sizeof(T) * 8, "index must be a bit of T");
+
+                char* pEnd = nullptr;
+                long long number = std::strtoll(value.c_str(), &pEnd, 10);
+                if (pEnd == value.c_str())
+                    return;
+
+                T& word = *static_cast<T*>(pData);
+                const T bit = static_cast<T>(static_cast<std::make_unsigned_t<T>>(1) << index); // never shifted into the sign bit
+                if (number > 0)
+                    word = static_cast<T>(word | bit);
+                else
+                    word = static_cast<T>(word & ~bit);
+            }
+
+            template<typename T, unsigned int index>
+            std::string getBit(void* pData) {
+                static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value && index < sizeof(T) * 8, "index must be a bit of T");
+                return ((static_cast<std::make_unsigned_t<T>>(*static_cast<T*>(pData)) >> index) & 1) ? "1" : "0";
+            }
+
+            /// @brief the functions a cvar of type T is registered with, used to check the type of a cvar
+            template<typename T>
+            struct Functions;
+
+#define _MAKE_CVARUTILS_FUNCTIONS_OF_TYPE(type, name) \
+    template<> \
+    struct Functions<type> { \
+        typedef void(*SetFunction)(void* pData, const std::string& value); \
+        static SetFunction setFunction() { return set ## name; } \
+    };
+
+            _MAKE_CVARUTILS_FUNCTIONS_OF_TYPE(std::string, String)
+            _MAKE_CVARUTILS_FUNCTIONS_OF_TYPE(bool, Boolean)
+            _MAKE_CVARUTILS_FUNCTIONS_OF_TYPE(double, Double)
+            _MAKE_CVARUTILS_FUNCTIONS_OF_TYPE(float, Float)
+            _MAKE_CVARUTILS_FUNCTIONS_OF_TYPE(int, Integer)
+            _MAKE_CVARUTILS_FUNCTIONS_OF_TYPE(unsigned int, UnsignedInteger)
+            _MAKE_CVARUTILS_FUNCTIONS_OF_TYPE(short, Short)
+            _MAKE_CVARUTILS_FUNCTIONS_OF_TYPE(unsigned short, UnsignedShort)
+            _MAKE_CVARUTILS_FUNCTIONS_OF_TYPE(unsigned char, UnsignedChar)
+        }
+
+        /// @brief typed access to words of packed flags, no string is involved
+        /// @note writing the word directly does not go through CVARStorage, so bit cvars in it are not reported as changed
+        namespace Bits {
+            template<typename T>
+            constexpr T mask() {
+                return 0;
+            }
+
+            /// @return a mask with every bit index given set
+            /// @note it is built unsigned, so the sign bit of a signed T is never shifted into
+            template<typename T, unsigned int index, unsigned int ... indices>
+            constexpr T mask() {
+                static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value && index < sizeof(T) * 8, "index must be a bit of T");
+                typedef std::make_unsigned_t<T> Unsigned;
+                return static_cast<T>(static_cast<Unsigned>(static_cast<Unsigned>(1) << index) | static_cast<Unsigned>(mask<T, indices...>()));
+            }
+
+            /// @brief sets every bit in mask to the same bit in values in a single write, the others are kept
+            template<typename T>
+            void write(T& word, T mask, T values) {
+                word = static_cast<T>((word & ~mask) | (values & mask));
+            }
+
+            template<unsigned int index, typename T>
+            bool get(const T& word) {
+                return (word & mask<T, index>()) != 0;
+            }
+
+            template<unsigned int index, typename T>
+            void set(T& word, bool value) {
+                write(word, mask<T, index>(), value ? mask<T, index>() : static_cast<T>(0));
+            }
         }
     }
 
+    /// @param value the cvar value as string
+    typedef void(*CvarCallback)(void* pData, const std::string& name, const std::string& value);
+
+    enum CvarFlags : unsigned char {
+        ARCHIVE = 1, // saved by CVARStorage::saveCvars
+        READ_ONLY = 2, // commands can not set it, only the host
+        CHEAT = 4 // commands can only set it while cheats are enabled
+    };
+
     struct CVariable {
         void (*set)(void* pData, const std::string& value);
         std::string (*toString)(void* pData);
+        void* pData = nullptr;
+
+        unsigned char flags = 0;
+        bool clamp = false;
+        double minValue = 0;
+        double maxValue = 0;
+
+        CvarCallback callback = nullptr;
+        void* pCallbackData = nullptr;
+        bool coalesce = false;
+
+        bool pending = false; // coalesced callback waiting for CVARStorage::dispatchChanges
+        bool dirty = false;
+        bool unsaved = false; // archived and changed since the last saveCvars
+    };
+
+    /// @brief a cvar known at build time, see CVARStorage::setCvars
+    struct CvarDefinition {
+        const char* name;
+        void* pData;
+        void (*set)(void* pData, const std::string& value);
+        std::string (*toString)(void* pData);
+        const char* usage;
+        unsigned char flags;
+    };
+
+    /// @brief a cvar looked up once, see CVARStorage::bindCvars
+    template<typename T>
+    struct CvarHandle {
+        const std::string* pName = nullptr;
+        CVariable* pCvar = nullptr;
+        T* pValue = nullptr;
     };
 
     class CVARStorage {
@@ -286,16 +1032,161 @@ namespace SweatCI {
         /// @param set to convert a string into the same type and set the new value
         /// @param toString get the cvar value as string
         /// @param usage to be printed out to the console if the user uses help command in it
-        static void setCvar(const std::string& name, void* pData, void(*set)(void* pData, const std::string& value), std::string (*toString)(void* pData), const std::string& usage);
+        /// @param flags CvarFlags
+        /// @note setting an existing cvar again keeps its callback
+        static void setCvar(const std::string& name, void* pData, void(*set)(void* pData, const std::string& value), std::string (*toString)(void* pData), const std::string& usage, unsigned char flags = 0);
+
+        /// @brief same as above, but numbers set by commands are clamped into [minValue, maxValue]
+        static void setCvar(const std::string& name, void* pData, void(*set)(void* pData, const std::string& value), std::string (*toString)(void* pData), const std::string& usage, unsigned char flags, double minValue, double maxValue);
+
+        /// @brief registers every cvar in definitions at once
+        static void setCvars(const CvarDefinition* pDefinitions, size_t count);
+
+        template<size_t N>
+        static void setCvars(const CvarDefinition (&definitions)[N]) {
+            setCvars(definitions, N);
+        }
+
+        /// @brief registers a cvar for bit index(0 is the lowest) of the integer at pData
+        template<typename T, unsigned int index>
+        static void setBitCvar(const std::string& name, T* pData, const std::string& usage, unsigned char flags = 0) {
+            setCvar(name, pData, Utils::Cvar::setBit<T, index>, Utils::Cvar::getBit<T, index>, usage, flags);
+        }
 
         /// @brief Searches for the CVAR and returns it to a buffer
         /// @return false if could not get cvar
         static bool getCvar(const std::string& name, CVariable*& pBuf);
 
+        /// @brief sets the cvar like the user would, marking it dirty and calling its callback if the value changed
+        /// @note throws whatever cvar.set throws
+        /// @return false if its flags do not allow it to be set or it's clamped and value is not a number, an error is printed
+        static bool setValue(const std::string& name, CVariable& cvar, void* pData, const std::string& value);
+
+        /// @brief callback is called whenever a command changes the cvar, nullptr removes it
+        /// @param coalesce if true, the callback is only called by dispatchChanges, once, with the value at that time
+        /// @return false if could not get cvar
+        static bool setCallback(const std::string& name, void* pData, CvarCallback callback, bool coalesce = false);
+
+        /// @brief calls the coalesced callbacks of cvars that changed since the last dispatch
+        /// @note called when the outermost exec ends and by Scheduler::tick
+        static void dispatchChanges();
+
+        /// @return the cvars changed by commands since the last clearDirtyCvars, in the order they first changed
+        /// @note changes done directly to the cvar data are not tracked
+        static const std::vector<std::string>& getDirtyCvars();
+        static void clearDirtyCvars();
+
+        /// @brief looks up every name once so the cvars can be read and written every frame without names or strings
+        /// @note T must be the type the cvar was registered for with Utils::Cvar, e.g. int for setInteger
+        /// @return false if a name is not a cvar of type T, its handle is left empty and ignored by readCvars and writeCvars
+        template<typename T>
+        static bool bindCvars(const std::vector<std::string>& names, std::vector<CvarHandle<T>>& handlesOut) {
+            bool bound = true;
+            handlesOut.assign(names.size(), CvarHandle<T>());
+
+            for (size_t i = 0; i < names.size(); ++i) {
+                auto it = cvars.find(names[i]);
+                if (it == cvars.end() || it->second.set != Utils::Cvar::Functions<T>::setFunction()) {
+                    bound = false;
+                    continue;
+                }
+
+                handlesOut[i].pName = &it->first;
+                handlesOut[i].pCvar = &it->second;
+                handlesOut[i].pValue = static_cast<T*>(it->second.pData);
+            }
+
+            return bound;
+        }
+
+        /// @param pValuesOut one value for each handle
+        template<typename T>
+        static void readCvars(const std::vector<CvarHandle<T>>& handles, T* pValuesOut) {
+            for (size_t i = 0; i < handles.size(); ++i)
+                if (handles[i].pValue != nullptr)
+                    pValuesOut[i] = *handles[i].pValue;
+        }
+
+        /// @brief writes the values that are different, those are reported like setValue does
+        /// @note flags and min/max are not checked, it's the host writing
+        template<typename T>
+        static void writeCvars(const std::vector<CvarHandle<T>>& handles, const T* pValues) {
+            for (size_t i = 0; i < handles.size(); ++i) {
+                if (handles[i].pValue == nullptr || *handles[i].pValue == pValues[i])
+                    continue;
+
+                *handles[i].pValue = pValues[i];
+                notifyChange(*handles[i].pName, *handles[i].pCvar, false);
+            }
+        }
+
+        static void setCheatsEnabled(bool enabled);
+        static bool areCheatsEnabled();
+
+        /// @brief appends the ARCHIVE cvars changed since the last save to path
+        /// @note the file is written whole if it was not the last one saved or loaded, or if most of its lines are old values
+        /// @return false if could not write file
+        static bool saveCvars(const std::string& path);
+
+        /// @brief sets the cvars saved by saveCvars, ignoring READ_ONLY and CHEAT
+        /// @note the file is also valid for exec, as long as no value has '$'
+        /// @return false if could not read file
+        static bool loadCvars(const std::string& path);
+
     private:
-        static std::unordered_map<std::string, CVariable> cvars;
+        static HostMap<std::string, CVariable> cvars;
+        static std::vector<std::string> pendingCvars;
+        static std::vector<std::string> dirtyCvars;
+        static std::vector<std::string> unsavedCvars;
+        static bool cheatsEnabled;
+
+        static std::string archivePath; // last file saved or loaded
+        static size_t archiveLineCount;
+        static size_t archivedCount;
+
+        friend class Memory;
         
         static void asCommand(CommandContext& ctx);
+        /// @brief sets and clamps the value without looking at the flags
+        /// @return false if the cvar is clamped and value is not a number, an error is printed
+        static bool applyValue(const std::string& name, CVariable& cvar, void* pData, const std::string& value, bool fromArchive);
+        /// @brief marks the cvar dirty and unsaved and calls or queues its callback
+        static void notifyChange(const std::string& name, CVariable& cvar, bool fromArchive);
+    };
+
+    /// @brief keeps track of which names each alias calls
+    class AliasGraph {
+    public:
+        /// @brief updates what name calls
+        /// @note prints a warning if name ends up calling itself
+        static void setAlias(const std::string& name, const std::string& commands);
+        static void removeAlias(const std::string& name);
+
+        /// @brief searches for a path of aliases that starts and ends in name
+        /// @note aliases starting with '!', '+' or '-' are not followed because they can not run forever
+        /// @return false if name does not call itself
+        static bool findCycle(const std::string& name, std::vector<std::string>& pathOut);
+
+        /// @return names called directly by the alias
+        static const std::vector<std::string>& getReferences(const std::string& name);
+
+        /// @return every alias that calls name directly or through other aliases
+        static std::vector<std::string> getDependents(const std::string& name);
+
+        /// @brief should be called whenever something that decides what an alias runs changes
+        static void changed();
+        /// @return a number that changes whenever an alias or the toggle state changes
+        /// @note variables changed directly by the host without using commands are not counted
+        static unsigned long long getGeneration();
+
+        static void clear();
+
+    private:
+        static HostMap<std::string, std::vector<std::string>> references;
+        static HostMap<std::string, std::unordered_set<std::string>> callers;
+        static unsigned long long generation;
+
+        friend class Memory;
     };
 
     extern std::vector<std::string> loopAliasesRunning;
@@ -303,28 +1194,194 @@ namespace SweatCI {
 
     void handleLoopAliasesRunning(std::unordered_map<std::string, std::string>* pVariables);
 
+    /// @brief what is left to run of a Parser that stopped before reaching _EOF
+    struct ParserState {
+        std::vector<Lexer> lexers{}; // lexers[0] is where the parsing started and the others are the aliases that were running
+        Token currentToken{}; // if NOTHING, the Parser advances before starting
+        std::vector<std::pair<std::string, unsigned long long>> runningAliases{}; // name and AliasGraph generation of each alias in lexers[1...]
+        unsigned long long recordId = 0; // how the Recorder knows it when it is resumed, 0 if it was not recorded
+    };
+
     class Parser {
     public:
         Parser(Lexer* pLexer, std::unordered_map<std::string, std::string>* pVariables);
+        /// @brief continues a suspended Parser
+        /// @note a state that a parse which reached the end left empty is already at the end, parsing it runs nothing
+        /// @warning state must outlive the Parser
+        Parser(ParserState& state, std::unordered_map<std::string, std::string>* pVariables);
+        Parser(const Parser&) = delete;
+        ~Parser();
+
         /// @param context should set the runningFrom variable as well as file related variables before calling this function
         void parse();
 
+        /// @brief parses until the end of the input or until the budget runs out
+        /// @param stateOut where what is left to run is saved. It can be the same state this Parser was constructed with
+        /// @param maxStatements 0 means no limit
+        /// @param maxMicroseconds 0 means no limit
+        /// @return true if reached the end
+        /// @note at least one statement is run on every call
+        bool parse(ParserState& stateOut, size_t maxStatements, unsigned long long maxMicroseconds = 0);
+
+        /// @brief makes the Parser run pLexer next, like a new Parser would
+        /// @note aliases left running by a parse that a throwing command unwound are dropped
+        void reset(Lexer* pLexer);
+
         unsigned short aliasMaxCalls = 50000;
 
     private:
-        std::vector<std::string> getArguments();
+        void getArguments(Arguments& argumentsOut);
         void advance();
-        void advanceUntil(const std::vector<TokenType>& tokenTypes);
+        void advanceUntil(std::initializer_list<TokenType> tokenTypes);
         void handleCommandToken();
+        /// @return true if something was run
+        bool parseStatement();
         /// @return true if should execute alias
         bool isSpecialAlias();
-        void handleAliasLexer(const std::string& input);
+        void handleAliasLexer(const std::string& name, const std::string& input);
+        /// @return true if name is already running and nothing changed since then, which means it would run forever
+        bool isRunningForever(const std::string& name);
+        /// @brief stops every alias running and skips the rest of the statement that called them
+        void stopAliases();
+        void endAliasTraces(size_t count);
+        /// @brief goes back to the lexers that called the aliases that reached _EOF
+        void popAliasLexers();
+        /// @brief moves everything that is left to run into stateOut and stops parsing
+        void suspend(ParserState& stateOut);
+        /// @brief deletes the lexers of every alias running, the last one first
+        void deleteAliasLexers();
+
+        /// @return true if nothing else is running and the Recorder can replay what this Parser runs
+        bool isRecorded() const;
+        /// @param statements how many ran before the budget stopped it, 0 if it reached the end
+        void record(bool newInput, size_t statements, unsigned long long startedMicroseconds);
 
         Token currentToken;
         Lexer* pLexer = nullptr;
+        bool isNewInput = false; // constructed from a Lexer, not a ParserState
+        unsigned long long recordId = 0; // see ParserState::recordId
+        std::vector<Lexer*> tempLexers; // lexers waiting for an alias to end. tempLexers[0] is not owned by the Parser
+        std::vector<std::pair<std::string, unsigned long long>> runningAliases; // name and AliasGraph generation of each alias in tempLexers
         std::unordered_map<std::string, std::string>* pVariables;
-        std::string getVariableFromCurrentTokenValue();
+        /// @return the value of the variable named like the current token, nullptr if there is none
+        const std::string* getVariableFromCurrentTokenValue();
+    };
+
+    /*
+     * Runs many small inputs, like the ones a host sends every frame, through one Lexer and one Parser that are reused
+     * instead of building them for each input. Every input runs like Parser(&Lexer{ctx, input}, pVariables).parse() would.
+     */
+    class Batch {
+    public:
+        /// @param ctx every input starts with a copy of it
+        Batch(const CommandContext& ctx, std::unordered_map<std::string, std::string>* pVariables);
+        Batch(const Batch&) = delete;
+
+        void run(const std::string& input);
+        void run(const char* pInput, size_t size);
+        /// @brief runs count inputs, in order
+        void run(const std::string* pInputs, size_t count);
+        void run(const std::vector<std::string>& inputs);
+
+        CommandContext ctx;
+        unsigned short aliasMaxCalls = 50000;
+
+    private:
+        std::unordered_map<std::string, std::string>* pVariables;
+        Lexer lexer;
+        Parser parser;
+        bool running = false; // if a command it runs runs it again, that input gets its own Lexer and Parser
+    };
+
+    class Scheduler {
+    public:
+        /// @brief runs every task that is due
+        /// @note should be called once per frame, it also calls CVARStorage::dispatchChanges
+        static void tick(std::unordered_map<std::string, std::string>* pVariables);
+
+        /// @brief continues state after the amount of frames
+        static void waitFrames(ParserState&& state, unsigned int frames);
+        /// @brief continues state after the amount of milliseconds
+        static void waitMilliseconds(ParserState&& state, unsigned long long milliseconds);
+
+        /// @brief makes the Parser that is running the current command stop and continue after the amount of frames
+        static void requestWait(unsigned int frames);
+
+        static void clear();
+        /// @return amount of tasks scheduled
+        static size_t size();
+        /// @return amount of ticks since the start
+        static unsigned long long getFrame();
+
+    private:
+        struct Task {
+            ParserState state;
+            unsigned long long due; // frame or millisecond
+            unsigned long long order; // keeps tasks with the same due in the order they were scheduled
+        };
+
+        typedef std::vector<Task, HostAllocator<Task>> Tasks;
+
+        static bool isDueLater(const Task& a, const Task& b);
+        static void pushTask(Tasks& tasks, ParserState&& state, unsigned long long due);
+        /// @brief moves every task with due <= now into out
+        static void popDueTasks(Tasks& tasks, unsigned long long now, Tasks& out);
+
+        static Tasks frameTasks;
+        static Tasks timerTasks;
+        static unsigned long long frame;
+        static unsigned long long taskCount;
+        static unsigned int pendingWait;
+
+        friend class Parser;
+        friend class Memory;
+        friend bool _invoke(CommandHandle& handle, CommandContext& ctx);
     };
 
+    /*
+     * Finds the files exec runs. A relative path is looked for next to the file that is running exec(CommandContext::filePath),
+     * then in the working directory and then in each search path.
+     * Whether a file exists is cached and the cache of a directory is only trusted while its modification time stays the same,
+     * which is checked once per outermost exec and again whenever the cache says a file is missing.
+     */
+    class PathResolver {
+    public:
+        /// @brief directories searched after the working directory, in order
+        static void setSearchPaths(const std::vector<std::string>& paths);
+        static const std::vector<std::string>& getSearchPaths();
+
+        /// @param fromFile file that is running exec, empty if none
+        /// @return false if not found
+        static bool resolve(const std::string& path, const std::string& fromFile, std::string& resolvedOut);
+
+        /// @brief forgets every lookup
+        static void flush();
+        /// @brief makes the next lookups check the directories' modification times again
+        static void expire();
+
+        /// @return how many times the file system was asked about a file or directory
+        static unsigned long long getProbeCount();
+
+    private:
+        /// @return true if it is a file, from the cache when it can be trusted
+        static bool exists(const std::string& path);
+
+        static std::vector<std::string> searchPaths;
+    };
+
+    /// @brief removes "//" and "/* */" comments that are not inside quotes
+    /// @param lineCount incremented for each line read
+    std::string stripComments(std::istream& input, size_t& lineCount);
+
+    /// @brief reads a .cfg file and strips its comments into a state ready to be parsed
+    /// @return false if could not load file
+    bool loadConfigFile(CommandContext ctx, const std::string& path, ParserState& stateOut);
+
+    /// @brief runs a .cfg file found by PathResolver, relative to ctx.filePath
     void execConfigFile(CommandContext ctx, const std::string& path, std::unordered_map<std::string, std::string>* pVariables);
+
+    /// @brief loads all files at the same time in threadCount threads and then executes them in the same order as paths
+    /// @note each file's size and modification time are checked right before it runs, one that the files before it rewrote or created is loaded again
+    /// @param threadCount 0 means one for each hardware thread
+    void execConfigFiles(CommandContext ctx, const std::vector<std::string>& paths, std::unordered_map<std::string, std::string>* pVariables, unsigned int threadCount = 0);
 }
@@ -0,0 +1,64 @@
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include "bench.h"
+
+/*
+ * Runs 1000 statements of a 3 deep alias chain, 3000 alias calls, and counts the calls to operator new they make.
+ * The short chain fits every token, argument and alias body inside its std::string, the long one does not.
+ * It does not use setAllocator, so building it at an older commit gives the numbers to compare with.
+ */
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+static std::unordered_map<std::string, std::string> variables;
+
+static void nop(SweatCI::CommandContext&) {}
+
+static void measure(const char* name, const std::string& aliases, const std::string& statement) {
+    Bench::run(aliases, &variables);
+
+    std::string input;
+    for (int i = 0; i < 1000; ++i)
+        input += statement;
+
+    double time = Bench::best(40, [&]() {
+        for (int i = 0; i < 100; ++i)
+            Bench::run(input, &variables);
+    });
+
+    size_t before = allocations;
+    Bench::run(input, &variables);
+
+    std::cout << name << ": allocations per alias call: " << (allocations - before) / 3000.0 << ", 300k alias calls: " << time << " ms\n";
+}
+
+int main() {
+    SweatCI::setPrintCallback(nullptr, Bench::ignorePrint);
+    SweatCI::BaseCommands::init(&variables);
+    SweatCI::registerCommand("nop", 0, 8, nop, "");
+    SweatCI::registerCommand("nop_with_a_long_name", 0, 8, nop, "");
+
+    measure("short", "alias a \"nop; b\"; alias b \"nop; c\"; alias c \"nop\"", "a;");
+    measure("long", "alias la \"nop some_long_argument_text another_long_argument; lb\"; "
+        "alias lb \"nop_with_a_long_name 1 2 3; lc\"; alias lc \"nop the_last_long_argument_of_all\"",
+        "nop first_long_argument_of_statement; la;");
+}
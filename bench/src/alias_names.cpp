@@ -0,0 +1,47 @@
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+/*
+ * Defines 100k aliases through the Parser, then checks the same names with the std::regex the alias command
+ * used to build on every call and with Utils::isValidName.
+ */
+
+static std::unordered_map<std::string, std::string> variables;
+
+int main() {
+    SweatCI::setPrintCallback(nullptr, Bench::ignorePrint);
+    SweatCI::BaseCommands::init(&variables);
+
+    std::string input;
+    std::vector<std::string> names;
+    for (int i = 0; i < 100000; ++i) {
+        names.push_back("a" + std::to_string(i % 1000));
+        input += "alias " + names.back() + " \"echo hi\"\n";
+    }
+
+    double parse = Bench::best(5, [&]() {
+        Bench::run(input, &variables);
+    });
+
+    size_t valid = 0;
+    double regex = Bench::best(5, [&]() {
+        for (const auto& name : names) {
+            std::regex whitespace_regex("\\S+");
+            valid += std::regex_match(name, whitespace_regex);
+        }
+    });
+
+    double table = Bench::best(5, [&]() {
+        for (const auto& name : names)
+            valid += SweatCI::Utils::isValidName(name);
+    });
+
+    std::cout << "100k alias definitions: " << parse << " ms\n";
+    std::cout << "100k names, std::regex: " << regex << " ms\n";
+    std::cout << "100k names, isValidName: " << table << " ms\n";
+    return valid == 0; // keeps the checks from being optimized away
+}
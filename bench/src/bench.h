@@ -0,0 +1,37 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+#include "SweatCI.h"
+
+/*
+ * Shared by the benchmarks: nothing is printed by SweatCI and every time is the best of some runs,
+ * so the numbers are comparable between builds of different commits.
+ */
+namespace Bench {
+    inline void ignorePrint(void*, const SweatCI::OutputLevel&, const std::string&) {}
+
+    /// @return milliseconds the fastest of runs calls to work took
+    template<typename F>
+    double best(int runs, F work) {
+        double fastest = 1e300;
+        for (int i = 0; i < runs; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            work();
+            fastest = std::min(fastest, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        return fastest;
+    }
+
+    inline void run(const std::string& input, std::unordered_map<std::string, std::string>* pVariables) {
+        SweatCI::CommandContext ctx;
+        ctx.runningFrom = SweatCI::CONSOLE;
+
+        SweatCI::Lexer lexer{ctx, input};
+        SweatCI::Parser(&lexer, pVariables).parse();
+    }
+}
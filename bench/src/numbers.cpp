@@ -0,0 +1,80 @@
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+/*
+ * Converts 200k random values of each type with numberToString and with the std::to_string and std::stringstream
+ * version it replaced, copied below.
+ */
+
+template<typename T>
+static std::string oldNumberToString(T value) {
+    std::string str = std::to_string(value);
+    std::stringstream out;
+
+    for (size_t i = 0; i < str.size(); ++i) {
+        if (str[i] == '.') {
+            while (str.back() == '0') {
+                str.pop_back();
+                if (str.back() == '.') {
+                    str.pop_back();
+                    break;
+                }
+            }
+        }
+
+        out << str[i];
+    }
+
+    return out.str();
+}
+
+static size_t sink = 0;
+
+template<typename T>
+static void compare(const std::string& name, const std::vector<T>& values) {
+    double old = Bench::best(5, [&]() {
+        for (auto value : values)
+            sink += oldNumberToString(value).size();
+    });
+
+    double current = Bench::best(5, [&]() {
+        for (auto value : values)
+            sink += SweatCI::numberToString(value).size();
+    });
+
+    std::cout << name << ": " << old * 1e6 / values.size() << " -> " << current * 1e6 / values.size() << " ns per call\n";
+}
+
+int main() {
+    std::mt19937 random(1);
+    std::vector<double> doubles, cents;
+    std::vector<float> floats;
+    std::vector<int> ints;
+    std::vector<unsigned int> uints;
+    std::vector<short> shorts;
+    std::vector<unsigned char> uchars;
+
+    for (int i = 0; i < 200000; ++i) {
+        doubles.push_back(std::uniform_real_distribution<double>(-1e6, 1e6)(random));
+        cents.push_back(std::uniform_int_distribution<int>(-10000000, 10000000)(random) / 100.0);
+        floats.push_back(std::uniform_int_distribution<int>(-100000, 100000)(random) / 100.0f);
+        ints.push_back(static_cast<int>(random()));
+        uints.push_back(static_cast<unsigned int>(random()));
+        shorts.push_back(static_cast<short>(random()));
+        uchars.push_back(static_cast<unsigned char>(random()));
+    }
+
+    compare("int", ints);
+    compare("unsigned int", uints);
+    compare("short", shorts);
+    compare("unsigned char", uchars);
+    compare("float", floats);
+    compare("double, 2 decimals", cents);
+    compare("double, full 17 digits", doubles);
+    return sink == 0; // keeps the conversions from being optimized away
+}
@@ -0,0 +1,31 @@
+#include <iostream>
+#include <string>
+
+#include "bench.h"
+
+/*
+ * Lexes 1.6M tokens, every nextToken result is moved into the Token the loop holds.
+ */
+
+static std::unordered_map<std::string, std::string> variables;
+
+int main() {
+    SweatCI::setPrintCallback(nullptr, Bench::ignorePrint);
+    SweatCI::BaseCommands::init(&variables); // the lexer looks up command names
+
+    std::string input;
+    for (int i = 0; i < 200000; ++i)
+        input += "echo \"hello world\" some_longer_argument_value_here; variable x_name_value 12345\n";
+
+    SweatCI::CommandContext ctx;
+    size_t count = 0;
+    double time = Bench::best(5, [&]() {
+        SweatCI::Lexer lexer{ctx, input};
+
+        count = 0;
+        for (SweatCI::Token token = lexer.nextToken(); token.getType() != SweatCI::TokenType::_EOF; token = lexer.nextToken())
+            ++count;
+    });
+
+    std::cout << count << " tokens: " << time << " ms, " << count / time / 1000 << " Mtokens/s\n";
+}
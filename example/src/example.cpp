@@ -299,5 +299,6 @@ int main()
         SweatCI::Parser(&lexer, &variables).parse();
         
         SweatCI::handleLoopAliasesRunning(&variables);
+        SweatCI::Scheduler::tick(&variables);
     }
 }
\ No newline at end of file
@@ -0,0 +1,223 @@
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "SweatCI.h"
+#include "reference.h"
+
+/*
+ * Runs the same input through different pipelines that must behave the same:
+ * - Reference::Lexer against SweatCI::Lexer (token stream and line/column)
+ * - Reference::stripComments against SweatCI::stripComments
+ * - Parser::parse against Parser::parse with a budget being resumed until the end (output, commands called and variables)
+ * Any difference aborts, so libFuzzer and the sanitizers report the input.
+ * There is no reference parser, so the output and the commands called are only compared between the whole
+ * and the sliced run: a change that makes both of them behave differently from before is not caught.
+ */
+
+static std::unordered_map<std::string, std::string> variables;
+static std::vector<std::string> trace;
+static int testInt = 0;
+
+struct Run {
+    std::vector<std::string> trace;
+    std::unordered_map<std::string, std::string> variables;
+};
+
+static void check(bool condition, const std::string& what) {
+    if (condition)
+        return;
+
+    std::cerr << "mismatch: " << what << "\n";
+    std::abort();
+}
+
+static void recordOutput(void*, const SweatCI::OutputLevel& level, const std::string& message) {
+    trace.push_back(std::to_string(level) + ' ' + message);
+}
+
+static void recordCommand(SweatCI::CommandContext& ctx) {
+    std::stringstream call;
+    call << ctx.pCommand->name << ' ' << ctx.runningFrom << ' ' << ctx.lineIndex << ':' << ctx.columnIndex;
+    for (const auto& arg : ctx.args)
+        call << " \"" << arg << '"';
+
+    trace.push_back(call.str());
+}
+
+static void init() {
+    SweatCI::setPrintCallback(nullptr, recordOutput);
+    SweatCI::BaseCommands::init(&variables);
+    SweatCI::Command::deleteCommand("exec"); // inputs should not touch the file system
+
+    SweatCI::registerCommand("t0", 0, 0, recordCommand, "");
+    SweatCI::registerCommand("t1", 1, 1, recordCommand, "");
+    SweatCI::registerCommand("t3", 0, 3, recordCommand, "");
+    SweatCI::registerCommand("+t", 0, 0, recordCommand, "");
+    SweatCI::registerCommand("-t", 0, 0, recordCommand, "");
+
+    SweatCI::CVARStorage::setCvar("t_int", &testInt, SweatCI::Utils::Cvar::setInteger, SweatCI::Utils::Cvar::getInteger, "");
+}
+
+static void reset() {
+    variables.clear();
+    trace.clear();
+    testInt = 0;
+
+    SweatCI::loopAliasesRunning.clear();
+    SweatCI::toggleTypesRunning.clear();
+    SweatCI::AliasGraph::clear();
+    SweatCI::Scheduler::clear();
+}
+
+static SweatCI::CommandContext makeContext() {
+    SweatCI::CommandContext ctx;
+    ctx.runningFrom = SweatCI::CONSOLE;
+    return ctx;
+}
+
+static void compareTokens(const std::string& input) {
+    SweatCI::Lexer lexer{makeContext(), input};
+    Reference::Lexer reference{makeContext(), input};
+
+    for (size_t i = 0;; ++i) {
+        SweatCI::Token token = lexer.nextToken();
+        SweatCI::Token expected = reference.nextToken();
+
+        std::string where = "token " + std::to_string(i);
+        check(token.getType() == expected.getType(), where + " type " + token.string() + " != " + expected.string());
+        check(token.getValue() == expected.getValue(), where + " value " + token.string() + " != " + expected.string());
+        check(lexer.ctx.lineIndex == reference.ctx.lineIndex && lexer.ctx.columnIndex == reference.ctx.columnIndex, where + " position");
+
+        if (token.getType() == SweatCI::TokenType::_EOF)
+            break;
+    }
+}
+
+static void compareStripping(const std::string& input) {
+    size_t lineCount = 0, expectedLineCount = 0;
+
+    std::istringstream stream(input), expectedStream(input);
+    std::string content = SweatCI::stripComments(stream, lineCount);
+    std::string expected = Reference::stripComments(expectedStream, expectedLineCount);
+
+    check(content == expected, "stripped content");
+    check(lineCount == expectedLineCount, "line count");
+}
+
+static Run runWhole(const std::string& input) {
+    reset();
+
+    SweatCI::Lexer lexer{makeContext(), input};
+    SweatCI::Parser parser{&lexer, &variables};
+    parser.aliasMaxCalls = 64;
+    parser.parse();
+
+    return {trace, variables};
+}
+
+static Run runSliced(const std::string& input, size_t statements) {
+    reset();
+
+    SweatCI::Lexer lexer{makeContext(), input};
+    SweatCI::ParserState state;
+    bool done;
+    {
+        SweatCI::Parser parser{&lexer, &variables};
+        parser.aliasMaxCalls = 64;
+        done = parser.parse(state, statements);
+    }
+
+    while (!done) {
+        SweatCI::Parser parser{state, &variables};
+        parser.aliasMaxCalls = 64;
+        done = parser.parse(state, statements);
+    }
+
+    return {trace, variables};
+}
+
+static void compareExecution(const std::string& input, size_t statements) {
+    Run whole = runWhole(input);
+    Run sliced = runSliced(input, statements);
+
+    check(whole.trace.size() == sliced.trace.size(), "trace size");
+    for (size_t i = 0; i < whole.trace.size(); ++i)
+        check(whole.trace[i] == sliced.trace[i], "trace " + std::to_string(i) + ": \"" + whole.trace[i] + "\" != \"" + sliced.trace[i] + '"');
+
+    check(whole.variables == sliced.variables, "variables");
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static bool initialized = false;
+    if (!initialized) {
+        init();
+        initialized = true;
+    }
+
+    if (size == 0)
+        return 0;
+
+    // first byte picks how many statements the sliced run does per call
+    size_t statements = data[0] % 4 + 1;
+    std::string input(reinterpret_cast<const char*>(data) + 1, size - 1);
+
+    compareTokens(input);
+    compareStripping(input);
+    compareExecution(input, statements);
+
+    return 0;
+}
+
+#ifdef SWEATCI_FUZZ_STANDALONE
+/// @brief builds inputs out of pieces that mean something to SweatCI
+static std::string randomInput(std::mt19937& random) {
+    static const char* pieces[] = {
+        "alias", "a", "b", "+a", "-a", "!a", "+t", "-t", "t0", "t1", "t3", "t_int", "echo", "toggle", "incrementvar",
+        "wait", "after", "variable", "$a", "$t_int", "\\$", "\\\"", "\\\\", "\"", ";", "\n", " ", "  ", "//", "/*", "*/", "0", "1", "x",
+        "alias a \"t0; b\";", "alias b \"t1 $t_int; a\";", "alias +a \"t3 1 2; +t\";", "alias -a \"-t; wait\";", "alias !a \"t0\";"
+    };
+
+    std::string input;
+    size_t count = random() % 48;
+    for (size_t i = 0; i < count; ++i) {
+        input += pieces[random() % (sizeof(pieces) / sizeof(pieces[0]))];
+
+        // mostly separate them so that they end up as statements
+        if (random() % 4 != 0)
+            input += ' ';
+    }
+
+    return input;
+}
+
+static void runInput(const std::string& input) {
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+}
+
+/// @brief without libFuzzer: runs the files given or, if none, random inputs
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; ++i) {
+            std::ifstream file(argv[i], std::ios::binary);
+            std::stringstream content;
+            content << file.rdbuf();
+            runInput(content.str());
+        }
+
+        return 0;
+    }
+
+    std::mt19937 random(1);
+    for (size_t i = 0; i < 100000; ++i)
+        runInput(static_cast<char>(random()) + randomInput(random));
+
+    std::cout << "no mismatches found\n";
+    return 0;
+}
+#endif
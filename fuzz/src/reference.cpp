@@ -0,0 +1,186 @@
+#include "reference.h"
+
+#include <sstream>
+
+using SweatCI::Token;
+using SweatCI::TokenType;
+
+namespace Reference {
+    Lexer::Lexer(const SweatCI::CommandContext& ctx, const std::string& input) : ctx(ctx), input(input) {}
+
+    bool Lexer::nextPosition() {
+        ++position;
+        ++ctx.columnIndex;
+
+        if (input[position] == '\n') {
+            ++ctx.lineIndex;
+            ctx.columnIndex = 0;
+            return true;
+        }
+
+        return false;
+    }
+
+    SweatCI::Token Lexer::nextToken() {
+        if (position >= input.length()) {
+            lastToken = {TokenType::_EOF, ""};
+            return lastToken;
+        }
+
+        char currentChar = input[position];
+        if (currentChar == '\n') {
+            ++position;
+            lastToken = Token(TokenType::EOS, "\n");
+            return lastToken;
+        }
+
+        while (std::isspace(currentChar)) {
+            if (nextPosition()) {
+                lastToken = Token(TokenType::EOS, "\n");
+                return lastToken;
+            }
+
+            if (position >= input.length()) {
+                lastToken = Token(TokenType::_EOF, "");
+                return lastToken;
+            }
+
+            currentChar = input[position];
+        }
+
+        if ((input[position] == ';' || input[position] == '\n') && (position == 0 || input[position-1] != '\\')) {
+            nextPosition();
+            lastToken = Token(TokenType::EOS, ";");
+            return lastToken;
+        }
+
+        lastToken = parseToken();
+        return lastToken;
+    }
+
+    bool Lexer::isCommand(const std::string& commandName) {
+        for (const auto& command : SweatCI::Command::getCommands()) {
+            if (command.name == commandName)
+                return true;
+        }
+
+        return false;
+    }
+
+    SweatCI::Token Lexer::parseToken() {
+        if (input[position] == '"')
+            return parseString();
+
+        std::string tokenValue;
+        // "\;" is part of the token, nextToken does not treat it as the end of the statement
+        while (position < input.length() && !std::isspace(input[position]) && (input[position] != ';' || (position != 0 && input[position-1] == '\\')) && input[position] != '\n') {
+            tokenValue += input[position];
+            nextPosition();
+        }
+
+        if (isCommand(tokenValue) && (lastToken.getType() == TokenType::NOTHING || lastToken.getType() != TokenType::COMMAND))
+            return Token(TokenType::COMMAND, tokenValue);
+        else
+            return Token(TokenType::STRING, tokenValue);
+    }
+
+    SweatCI::Token Lexer::parseString() {
+        std::string tokenValue = "";
+
+        ++position; // Skip the first double quote
+        ++ctx.columnIndex;
+
+        while (position < input.length() && input[position] != '"') {
+            // escape '\\'
+            if (input[position] == '\\' && position + 1 < input.length() && input[position+1] == '\\')
+                nextPosition();
+            
+            // escape '"'
+            else if (input[position] == '\\' && position + 1 < input.length() && input[position+1] == '"')
+                nextPosition();
+
+            tokenValue += input[position];
+            nextPosition();
+        }
+
+        if (input[position] == '"')
+            nextPosition(); // Skip the last double quote if exists
+
+        return Token(TokenType::STRING, tokenValue);
+    }
+
+    std::string stripComments(std::istream& file, size_t& lineCount) {
+        bool inComment = false;
+        bool inQuotes = false;
+
+        std::stringstream content;
+        while (file.good()) {
+            std::string line;
+            std::getline(file, line);
+            ++lineCount;
+
+            bool removeOneFromIndex = false; // if it was left true by the previous line, i would underflow
+
+            for (size_t i = 0; i < line.size(); ++i) {
+                if (removeOneFromIndex) {
+                    --i;
+                    removeOneFromIndex = false;
+                }
+
+                if (!inQuotes && line[i] == '*' && line.size()-1 != i) {
+                    if (line[i+1] != '/') continue;
+
+                    if (inComment) {
+                        inComment = false;
+                        line = line.substr(i+2);
+                        i = 0;
+                        removeOneFromIndex = true;
+                    } else { // comment everything before and above
+                        content.str(std::string());
+                        line = line.substr(i+2);
+                        i = 0;
+                        removeOneFromIndex = true;
+                    }
+                
+                    continue;
+                }
+
+                if (inComment) continue;
+
+                if (line[i] == '"' && (i == 0 || line[i-1] != '\\')) {
+                    inQuotes = !inQuotes;
+                    continue;
+                }
+
+                if (inQuotes) continue;
+
+                if (line[i] == '/' && line.size()-1 != i) {
+                    if (line[i+1] == '*') {
+                        inComment = true;
+                        content << line.substr(0, i);
+                        i = 0;
+                        removeOneFromIndex = true;
+                        continue;
+                    } else if (line[i+1] == '/') {
+                        line = line.substr(0, i);
+                        break;
+                    }
+                }
+            }
+
+            if (!inComment) {
+                content << line;
+                if (!inQuotes)
+                    content << '\n';
+            }
+            /*
+            if (inQuotes)
+                content << ' ';
+            else
+                content << ';';
+            */
+        }
+
+        return content.str();
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <istream>
+
+#include "SweatCI.h"
+
+/// @brief copies of the lexer and comment stripper as they were before any optimization,
+/// so that SweatCI_fuzz can compare them against the current ones
+/// @note the only changes are that "\;" no longer makes the lexer return empty tokens forever
+/// and that a line ending with "*/" no longer makes stripComments read before the start of the next line
+/// @warning do not change the behaviour of anything in here
+namespace Reference {
+    class Lexer {
+    public:
+        Lexer(const SweatCI::CommandContext& ctx, const std::string& input);
+
+        SweatCI::Token nextToken();
+
+        SweatCI::CommandContext ctx;
+    private:
+        /// @note skips newline
+        /// @return true if is newline
+        bool nextPosition();
+        bool isCommand(const std::string& commandName);
+        SweatCI::Token parseToken();
+        SweatCI::Token parseString();
+
+        std::string input;
+        size_t position = 0;
+        SweatCI::Token lastToken;
+    };
+
+    std::string stripComments(std::istream& file, size_t& lineCount);
+}
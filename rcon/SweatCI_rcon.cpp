@@ -0,0 +1,365 @@
+#include "SweatCI_rcon.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace SweatCI {
+    static bool setNonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+    }
+
+    /// @brief compares without stopping at the first difference, so the time taken does not tell how much was right
+    static bool isSamePassword(const std::string& attempt, const std::string& password) {
+        unsigned char difference = attempt.size() != password.size();
+        for (size_t i = 0; i < attempt.size(); ++i)
+            difference |= static_cast<unsigned char>(attempt[i] ^ (i < password.size() ? password[i] : 0));
+
+        return difference == 0;
+    }
+
+    RconServer::RconServer(const std::string& password, std::unordered_map<std::string, std::string>* pVariables) : password(password), pVariables(pVariables) {}
+
+    RconServer::~RconServer() {
+        close();
+    }
+
+    bool RconServer::addListener(int fd, const std::string& what) {
+        if (epollFd == -1) {
+            epollFd = epoll_create1(EPOLL_CLOEXEC);
+            if (epollFd == -1) {
+                printf(OutputLevel::_ERROR, "rcon: could not create epoll: {}\n", std::strerror(errno));
+                ::close(fd);
+                return false;
+            }
+        }
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+
+        if (listen(fd, SOMAXCONN) == -1 || !setNonBlocking(fd) || epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            printf(OutputLevel::_ERROR, "rcon: could not listen on {}: {}\n", what, std::strerror(errno));
+            ::close(fd);
+            return false;
+        }
+
+        listenFds.push_back(fd);
+        return true;
+    }
+
+    bool RconServer::listenTcp(const std::string& address, unsigned short port) {
+        if (password.empty()) {
+            print(OutputLevel::_ERROR, "rcon: refusing to listen without a password\n");
+            return false;
+        }
+
+        sockaddr_in socketAddress{};
+        socketAddress.sin_family = AF_INET;
+        socketAddress.sin_port = htons(port);
+        if (inet_pton(AF_INET, address.c_str(), &socketAddress.sin_addr) != 1) {
+            printf(OutputLevel::_ERROR, "rcon: \"{}\" is not an IPv4 address\n", address);
+            return false;
+        }
+
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int reuse = 1;
+        if (fd != -1)
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        if (fd == -1 || bind(fd, reinterpret_cast<sockaddr*>(&socketAddress), sizeof(socketAddress)) == -1) {
+            printf(OutputLevel::_ERROR, "rcon: could not bind {}:{}: {}\n", address, port, std::strerror(errno));
+            if (fd != -1)
+                ::close(fd);
+            return false;
+        }
+
+        socklen_t length = sizeof(socketAddress);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&socketAddress), &length);
+
+        if (!addListener(fd, address + ':' + std::to_string(port)))
+            return false;
+
+        this->port = ntohs(socketAddress.sin_port);
+        return true;
+    }
+
+    bool RconServer::listenUnix(const std::string& path) {
+        if (password.empty()) {
+            print(OutputLevel::_ERROR, "rcon: refusing to listen without a password\n");
+            return false;
+        }
+
+        sockaddr_un socketAddress{};
+        socketAddress.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(socketAddress.sun_path)) {
+            printf(OutputLevel::_ERROR, "rcon: \"{}\" is too long for a socket path\n", path);
+            return false;
+        }
+
+        std::memcpy(socketAddress.sun_path, path.c_str(), path.size() + 1);
+        unlink(path.c_str());
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1 || bind(fd, reinterpret_cast<sockaddr*>(&socketAddress), sizeof(socketAddress)) == -1) {
+            printf(OutputLevel::_ERROR, "rcon: could not bind \"{}\": {}\n", path, std::strerror(errno));
+            if (fd != -1)
+                ::close(fd);
+            return false;
+        }
+
+        if (!addListener(fd, path))
+            return false;
+
+        unixPaths.push_back(path);
+        return true;
+    }
+
+    void RconServer::poll(int timeoutMilliseconds) {
+        if (epollFd == -1)
+            return;
+
+        epoll_event events[64];
+        int count = epoll_wait(epollFd, events, 64, timeoutMilliseconds);
+
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (std::find(listenFds.begin(), listenFds.end(), fd) != listenFds.end()) {
+                accept(fd);
+                continue;
+            }
+
+            auto it = clients.find(fd);
+            if (it == clients.end())
+                continue;
+
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                receive(it->second);
+
+            // receive may have disconnected it
+            it = clients.find(fd);
+            if (it != clients.end() && (events[i].events & EPOLLOUT))
+                send(it->second);
+        }
+
+        disconnectUnauthenticated();
+    }
+
+    void RconServer::disconnectUnauthenticated() {
+        auto now = std::chrono::steady_clock::now();
+
+        for (auto it = clients.begin(); it != clients.end();) {
+            int fd = it->first;
+            bool late = !it->second.authenticated && now - it->second.connectedAt >= std::chrono::milliseconds(authTimeoutMilliseconds);
+            ++it; // disconnect erases it
+
+            if (late)
+                disconnect(fd);
+        }
+    }
+
+    void RconServer::accept(int listenFd) {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd == -1)
+                return; // EAGAIN once every pending connection was taken
+
+            if (clients.size() >= maxClients) {
+                ::close(fd);
+                continue;
+            }
+
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+                ::close(fd);
+                continue;
+            }
+
+            Client& client = clients[fd];
+            client.fd = fd;
+            client.id = nextClientId++;
+            client.connectedAt = std::chrono::steady_clock::now();
+        }
+    }
+
+    void RconServer::receive(Client& client) {
+        int fd = client.fd;
+        char buffer[65536];
+
+        while (!client.closing) {
+            ssize_t size = recv(fd, buffer, sizeof(buffer), 0);
+            if (size == 0 || (size == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                disconnect(fd);
+                return;
+            }
+
+            if (size == -1) {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+
+            // lines run as they arrive, so what is kept is never more than a line and what the last recv brought
+            client.input.append(buffer, static_cast<size_t>(size));
+            if (!runLines(client)) {
+                disconnect(fd);
+                return;
+            }
+
+            if (static_cast<size_t>(size) < sizeof(buffer))
+                break;
+        }
+
+        send(client);
+    }
+
+    bool RconServer::runLines(Client& client) {
+        // every complete line is run, the rest waits for more input
+        size_t lineStart = 0;
+        for (size_t lineEnd = client.input.find('\n'); lineEnd != std::string::npos; lineEnd = client.input.find('\n', lineStart)) {
+            std::string line = client.input.substr(lineStart, lineEnd - lineStart);
+            lineStart = lineEnd + 1;
+
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+
+            runLine(client, line);
+            if (client.closing)
+                break;
+        }
+
+        client.input.erase(0, lineStart);
+        return client.input.size() <= maxLineLength;
+    }
+
+    void RconServer::runLine(Client& client, const std::string& line) {
+        if (!client.authenticated) {
+            client.authenticated = isSamePassword(line, password);
+            client.output += client.authenticated ? "authenticated\n" : "bad password\n";
+            client.closing = !client.authenticated;
+            return;
+        }
+
+        if (line.size() > maxLineLength) {
+            client.closing = true;
+            return;
+        }
+
+        CommandContext ctx;
+        ctx.runningFrom = REMOTE;
+        ctx.sourceId = client.id;
+
+        // everything printed while the line runs goes to the client, and still to the host
+        hostPrintCallback = printCallback;
+        pHostPrintCallbackData = pPrintCallbackData;
+        pRunningClient = &client;
+        setPrintCallback(this, capturePrint);
+
+        // given back even if a command throws
+        struct CaptureScope {
+            RconServer* pServer;
+
+            ~CaptureScope() {
+                setPrintCallback(pServer->pHostPrintCallbackData, pServer->hostPrintCallback);
+                pServer->pRunningClient = nullptr;
+            }
+        } capture{this};
+
+        Lexer lexer{ctx, line};
+        Parser(&lexer, pVariables).parse();
+    }
+
+    void RconServer::capturePrint(void* pData, const OutputLevel& level, const std::string& message) {
+        RconServer* pServer = static_cast<RconServer*>(pData);
+        pServer->pRunningClient->output += message;
+
+        if (pServer->hostPrintCallback != nullptr)
+            pServer->hostPrintCallback(pServer->pHostPrintCallbackData, level, message);
+    }
+
+    void RconServer::send(Client& client) {
+        int fd = client.fd;
+
+        while (!client.output.empty()) {
+            ssize_t size = ::send(fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+            if (size == -1) {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    disconnect(fd);
+                    return;
+                }
+                break;
+            }
+
+            client.output.erase(0, static_cast<size_t>(size));
+        }
+
+        if (client.output.empty() && client.closing) {
+            disconnect(fd);
+            return;
+        }
+
+        if (client.output.size() > maxOutputSize) {
+            disconnect(fd);
+            return;
+        }
+
+        watchOutput(client);
+    }
+
+    void RconServer::watchOutput(Client& client) {
+        epoll_event event{};
+        event.events = client.output.empty() ? EPOLLIN : EPOLLIN | EPOLLOUT;
+        event.data.fd = client.fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, client.fd, &event);
+    }
+
+    void RconServer::disconnect(int fd) {
+        auto it = clients.find(fd);
+        if (it != clients.end())
+            RateLimiter::forgetSource(REMOTE, it->second.id);
+
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        clients.erase(fd);
+    }
+
+    void RconServer::close() {
+        while (!clients.empty())
+            disconnect(clients.begin()->first);
+
+        for (int fd : listenFds)
+            ::close(fd);
+        listenFds.clear();
+
+        for (const auto& path : unixPaths)
+            unlink(path.c_str());
+        unixPaths.clear();
+
+        if (epollFd != -1)
+            ::close(epollFd);
+        epollFd = -1;
+        port = 0;
+    }
+
+    size_t RconServer::getClientCount() const {
+        return clients.size();
+    }
+
+    unsigned short RconServer::getPort() const {
+        return port;
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "SweatCI.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace SweatCI {
+    /*
+     * Remote console over TCP or UNIX sockets, Linux only(epoll).
+     * The protocol is plain text lines: the first line a client sends is the password, every line after it is run
+     * like it was typed in the console, with CommandContext::runningFrom set to REMOTE.
+     * Whatever the commands print is sent back to the client that sent them.
+     * Each client has its own CommandContext::sourceId, so RateLimiter quotas for REMOTE can be QUOTA_PER_ID.
+     * Clients that do not send the password within authTimeoutMilliseconds are disconnected, so they can not hold every slot.
+     * Nothing runs in another thread, RconServer::poll does all the work and never blocks unless asked to.
+     */
+    class RconServer {
+    public:
+        /// @param password clients must send it as their first line, listening fails if it's empty
+        RconServer(const std::string& password, std::unordered_map<std::string, std::string>* pVariables);
+        ~RconServer();
+
+        RconServer(const RconServer&) = delete;
+        RconServer& operator=(const RconServer&) = delete;
+
+        /// @param port 0 picks any free port, see getPort
+        /// @return false if could not listen, the reason is printed
+        bool listenTcp(const std::string& address, unsigned short port);
+
+        /// @note an existing file at path is removed first
+        /// @return false if could not listen, the reason is printed
+        bool listenUnix(const std::string& path);
+
+        /// @brief accepts clients, runs the commands they sent and sends back what they printed
+        /// @param timeoutMilliseconds how long to wait for something to happen, 0 returns right away
+        /// @note should be called once per frame from the thread that runs commands, late clients are only disconnected by it
+        void poll(int timeoutMilliseconds = 0);
+
+        /// @brief disconnects every client and stops listening
+        void close();
+
+        size_t getClientCount() const;
+
+        /// @return port of the last TCP socket listening, 0 if none
+        unsigned short getPort() const;
+
+        size_t maxClients = 256;
+        size_t maxLineLength = 4096; // longer lines disconnect the client
+        size_t maxOutputSize = 1 << 20; // a client that does not read its output is disconnected once it has this many bytes waiting
+        unsigned int authTimeoutMilliseconds = 5000; // how long a client has to send the password
+
+    private:
+        struct Client {
+            int fd = -1;
+            unsigned long long id = 0; // CommandContext::sourceId of its commands
+            bool authenticated = false;
+            bool closing = false; // disconnected once its output is sent
+            std::string input; // incomplete line
+            std::string output; // waiting to be sent
+            std::chrono::steady_clock::time_point connectedAt;
+        };
+
+        bool addListener(int fd, const std::string& what);
+        void accept(int listenFd);
+        void receive(Client& client);
+        void send(Client& client);
+        /// @return false if what is left after the last complete line is longer than maxLineLength
+        bool runLines(Client& client);
+        void runLine(Client& client, const std::string& line);
+        void disconnect(int fd);
+        /// @brief disconnects the clients that did not send the password in time
+        void disconnectUnauthenticated();
+        /// @brief asks epoll to tell when the client can be written to, only while it has output waiting
+        void watchOutput(Client& client);
+
+        static void capturePrint(void* pData, const OutputLevel& level, const std::string& message);
+
+        std::string password;
+        std::unordered_map<std::string, std::string>* pVariables;
+
+        int epollFd = -1;
+        std::vector<int> listenFds;
+        std::vector<std::string> unixPaths; // removed on close
+        std::unordered_map<int, Client> clients;
+        unsigned short port = 0;
+        unsigned long long nextClientId = 1;
+
+        Client* pRunningClient = nullptr; // whose command is running, gets what is printed
+        PrintCallback hostPrintCallback = nullptr; // what print did before the command started running
+        void* pHostPrintCallbackData = nullptr;
+    };
+}
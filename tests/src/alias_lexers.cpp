@@ -0,0 +1,40 @@
+#include "test.h"
+
+/*
+ * The lexers of aliases that ended are kept for the next aliases and reset by them, but only a few,
+ * so a deep chain of aliases does not hold its inputs once it ends.
+ */
+
+static std::unordered_map<std::string, std::string> variables;
+
+static size_t lexerCount() {
+    return SweatCI::Memory::getUsage(SweatCI::MEMORY_LEXERS).count;
+}
+
+int main() {
+    SweatCI::setPrintCallback(nullptr, Test::capturePrint);
+    SweatCI::BaseCommands::init(&variables);
+
+    // d0 -> d1 -> ... -> d63, each one prints its depth before and after calling the next
+    std::string aliases;
+    for (int i = 0; i < 64; ++i)
+        aliases += "alias d" + std::to_string(i) + " \"echo in_" + std::to_string(i) + (i < 63 ? "; d" + std::to_string(i + 1) : "")
+            + "; echo out_" + std::to_string(i) + "\";";
+    Test::run(aliases, &variables);
+
+    size_t before = lexerCount();
+    Test::run("d0", &variables);
+    CHECK(Test::countOutput("in_") == 64);
+    CHECK(Test::countOutput("out_") == 64);
+    CHECK(Test::output().back() == "out_0\n");
+    CHECK(lexerCount() <= before + 16);
+
+    // the kept lexers are reset, the next aliases do not see what the last ones had left
+    Test::output().clear();
+    Test::run("alias short \"echo x\"; short; d62", &variables);
+    std::vector<std::string> expected = {"x\n", "in_62\n", "in_63\n", "out_63\n", "out_62\n"};
+    CHECK(Test::output() == expected);
+    CHECK(lexerCount() <= before + 16);
+
+    return Test::result();
+}
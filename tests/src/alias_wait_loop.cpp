@@ -0,0 +1,32 @@
+#include "test.h"
+
+// an alias that waits and then calls itself runs once per frame, it's not calling itself forever
+int main() {
+    std::unordered_map<std::string, std::string> variables;
+    SweatCI::setPrintCallback(nullptr, Test::capturePrint);
+    SweatCI::BaseCommands::init(&variables);
+
+    Test::run("alias loop \"echo tick; wait; loop\"", &variables);
+    CHECK(Test::countOutput("calls itself") == 0);
+
+    Test::run("loop", &variables);
+    CHECK(Test::countOutput("tick") == 1);
+
+    for (int i = 0; i < 10; ++i)
+        SweatCI::Scheduler::tick(&variables);
+
+    CHECK(Test::countOutput("tick") == 11);
+    CHECK(Test::countOutput("forever") == 0);
+    CHECK(SweatCI::Scheduler::size() == 1);
+
+    // without the wait it is still stopped right away
+    Test::output().clear();
+    Test::run("alias spin \"echo spin; spin\"", &variables);
+    CHECK(Test::countOutput("calls itself") == 1);
+
+    Test::run("spin", &variables);
+    CHECK(Test::countOutput("spin\n") == 2);
+    CHECK(Test::countOutput("forever") == 1);
+
+    return Test::result();
+}
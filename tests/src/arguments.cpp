@@ -0,0 +1,51 @@
+#include <stdexcept>
+
+#include "test.h"
+
+/*
+ * Arguments has to work like the std::vector<std::string> it replaced, inline and after it moved to the heap.
+ */
+
+static std::vector<std::string> toVector(const SweatCI::Arguments& arguments) {
+    return arguments;
+}
+
+int main() {
+    SweatCI::Arguments arguments{"a", "c"};
+
+    CHECK(*arguments.insert(arguments.begin() + 1, "b") == "b");
+    CHECK(toVector(arguments) == (std::vector<std::string>{"a", "b", "c"}));
+    CHECK(arguments.data() == &arguments.front());
+
+    // moves past the inline arguments
+    for (const char* argument : {"d", "e", "f"})
+        arguments.insert(arguments.end(), argument);
+    std::string first = "first";
+    arguments.insert(arguments.begin(), std::move(first));
+    CHECK(toVector(arguments) == (std::vector<std::string>{"first", "a", "b", "c", "d", "e", "f"}));
+
+    // inserting one of its own arguments
+    arguments.insert(arguments.begin(), arguments.back());
+    CHECK(arguments.at(0) == "f");
+    CHECK(arguments.size() == 8);
+
+    CHECK(*arguments.erase(arguments.begin()) == "first");
+    CHECK(*arguments.erase(arguments.begin() + 1, arguments.begin() + 4) == "d");
+    CHECK(toVector(arguments) == (std::vector<std::string>{"first", "d", "e", "f"}));
+    CHECK(arguments.erase(arguments.end() - 1) == arguments.end());
+    CHECK(arguments.back() == "e");
+
+    bool threw = false;
+    try {
+        arguments.at(arguments.size());
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    CHECK(threw);
+
+    const SweatCI::Arguments& constArguments = arguments;
+    CHECK(constArguments.at(1) == "d");
+    CHECK(constArguments.data()[2] == "e");
+
+    return Test::result();
+}
@@ -0,0 +1,57 @@
+#include <stdexcept>
+
+#include "test.h"
+
+/*
+ * A command that throws out of Batch::run must not leave the Batch marked as running, which would make every later input
+ * build a Lexer and Parser of its own, nor leave the aliases it was running alive in the reused Parser.
+ */
+
+static std::unordered_map<std::string, std::string> variables;
+static size_t lexersWhileRunning = 0;
+
+static void countLexers(SweatCI::CommandContext&) {
+    lexersWhileRunning = SweatCI::Memory::getUsage(SweatCI::MEMORY_LEXERS).count;
+}
+
+static void boom(SweatCI::CommandContext&) {
+    throw std::runtime_error("boom");
+}
+
+int main() {
+    SweatCI::setPrintCallback(nullptr, Test::capturePrint);
+    SweatCI::BaseCommands::init(&variables);
+    SweatCI::registerCommand("count_lexers", 0, 0, countLexers, "");
+    SweatCI::registerCommand("boom", 0, 0, boom, "");
+
+    SweatCI::CommandContext ctx;
+    ctx.runningFrom = SweatCI::CONSOLE;
+    SweatCI::Batch batch(ctx, &variables);
+
+    // alias lexers are kept for the next aliases once they end, so one is made before counting
+    batch.run("alias warm \"echo warm\"; alias throwing \"echo in_alias; boom\"; warm");
+    batch.run("count_lexers");
+    size_t lexersBefore = lexersWhileRunning;
+    size_t lexersIdle = SweatCI::Memory::getUsage(SweatCI::MEMORY_LEXERS).count;
+
+    bool thrown = false;
+    try {
+        batch.run("throwing");
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(Test::countOutput("in_alias") == 1);
+
+    // the alias lexer was given back, so the next alias takes it instead of a new one, and the next input runs in the Batch's own Lexer again
+    batch.run("warm");
+    CHECK(Test::countOutput("warm") == 2);
+    CHECK(SweatCI::Memory::getUsage(SweatCI::MEMORY_LEXERS).count == lexersIdle);
+    batch.run("count_lexers");
+    CHECK(lexersWhileRunning == lexersBefore);
+
+    batch.run("echo after");
+    CHECK(Test::countOutput("after") == 1);
+
+    return Test::result();
+}
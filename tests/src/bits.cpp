@@ -0,0 +1,34 @@
+#include "test.h"
+
+#include <limits>
+
+// masks and bit cvars reach the sign bit of signed integers
+int main() {
+    static_assert(SweatCI::Utils::Bits::mask<int, 31>() == std::numeric_limits<int>::min(), "sign bit of int");
+    static_assert(SweatCI::Utils::Bits::mask<long long, 63, 0>() == std::numeric_limits<long long>::min() + 1, "sign and lowest bit of long long");
+    static_assert(SweatCI::Utils::Bits::mask<unsigned char, 7, 1>() == 0x82, "bits of unsigned char");
+
+    signed char byte = 0;
+    SweatCI::Utils::Bits::set<7>(byte, true);
+    CHECK(byte == std::numeric_limits<signed char>::min());
+    CHECK(SweatCI::Utils::Bits::get<7>(byte));
+    SweatCI::Utils::Bits::set<7>(byte, false);
+    CHECK(byte == 0);
+
+    std::unordered_map<std::string, std::string> variables;
+    SweatCI::setPrintCallback(nullptr, Test::capturePrint);
+    SweatCI::BaseCommands::init(&variables);
+
+    int flags = 0;
+    SweatCI::CVARStorage::setCvar("t_sign", &flags, SweatCI::Utils::Cvar::setBit<int, 31>, SweatCI::Utils::Cvar::getBit<int, 31>, "");
+
+    Test::run("t_sign 1", &variables);
+    CHECK(flags == std::numeric_limits<int>::min());
+    CHECK((SweatCI::Utils::Cvar::getBit<int, 31>(&flags) == "1"));
+
+    Test::run("t_sign 0", &variables);
+    CHECK(flags == 0);
+    CHECK((SweatCI::Utils::Cvar::getBit<int, 31>(&flags) == "0"));
+
+    return Test::result();
+}
@@ -0,0 +1,69 @@
+#include "test.h"
+
+/*
+ * Commands registered from a CommandTable are found through its perfect hash, the first command with a name wins
+ * and deleting one of them makes the rest of its table be found like any other command.
+ */
+
+static std::unordered_map<std::string, std::string> variables;
+static int ones = 0, twos = 0, earlier = 0;
+
+static void one(SweatCI::CommandContext&) { ++ones; }
+static void two(SweatCI::CommandContext&) { ++twos; }
+static void registeredEarlier(SweatCI::CommandContext&) { ++earlier; }
+
+static constexpr SweatCI::CommandDefinition commands[] = {
+    {"t_one", 0, 0, one, "- the first one"},
+    {"t_two", 0, 1, two, "[value] - the second one"}
+};
+static constexpr SweatCI::CommandTable<2> commandTable(commands);
+
+static constexpr SweatCI::CommandDefinition duplicates[] = {
+    {"t_earlier", 0, 0, one, ""},
+    {"t_three", 0, 0, two, ""}
+};
+static constexpr SweatCI::CommandTable<2> duplicateTable(duplicates);
+
+int main() {
+    SweatCI::setPrintCallback(nullptr, Test::capturePrint);
+    SweatCI::BaseCommands::init(&variables);
+    SweatCI::registerCommand("t_earlier", 0, 0, registeredEarlier, "");
+
+    SweatCI::registerCommands(commandTable);
+    SweatCI::Command* pCommand = nullptr;
+    CHECK(SweatCI::Command::getCommand("t_one", pCommand, false) && pCommand->callback == one);
+    CHECK(pCommand->getUsage() == "- the first one");
+    CHECK(SweatCI::Command::getCommand("t_two", pCommand, false) && pCommand->callback == two && pCommand->maxArgs == 1);
+    CHECK(!SweatCI::Command::getCommand("t_none", pCommand, false));
+    CHECK(SweatCI::Command::getCommand("echo", pCommand, false)); // from the table of BaseCommands::init
+
+    Test::run("t_one; t_two 5; t_none", &variables);
+    CHECK(ones == 1 && twos == 1);
+    CHECK(Test::countOutput("t_none") == 1);
+
+    // a name that already exists is reported, the command registered first is the one found
+    SweatCI::registerCommands(duplicateTable);
+    CHECK(Test::countOutput("\"t_earlier\" already exists") == 1);
+    CHECK(SweatCI::Command::getCommand("t_earlier", pCommand, false) && pCommand->callback == registeredEarlier);
+    CHECK(SweatCI::Command::getCommand("t_three", pCommand, false) && pCommand->callback == two);
+    Test::run("t_earlier", &variables);
+    CHECK(earlier == 1 && ones == 1);
+
+    // deleting an entry leaves the others of its table
+    CHECK(SweatCI::Command::deleteCommand("t_one"));
+    CHECK(!SweatCI::Command::getCommand("t_one", pCommand, false));
+    CHECK(SweatCI::Command::getCommand("t_two", pCommand, false) && pCommand->callback == two);
+    CHECK(pCommand->getUsage() == "[value] - the second one");
+    CHECK(SweatCI::Command::getCommand("echo", pCommand, false));
+
+    Test::run("t_one; t_two", &variables);
+    CHECK(ones == 1 && twos == 2);
+
+    // a table registered again after its commands were deleted is used again
+    CHECK(SweatCI::Command::deleteCommand("t_two"));
+    SweatCI::registerCommands(commandTable);
+    Test::run("t_one; t_two", &variables);
+    CHECK(ones == 2 && twos == 3);
+
+    return Test::result();
+}
@@ -0,0 +1,63 @@
+#include "test.h"
+
+/*
+ * Command usages are kept in slots apart from the commands: registering gives one, deleting gives it back
+ * and copies of a command that was deleted or cleared do not see the usage of the command in its slot now.
+ */
+
+static std::unordered_map<std::string, std::string> variables;
+
+static void nop(SweatCI::CommandContext&) {}
+
+static size_t commandBytes() {
+    SweatCI::Memory::measure(&variables);
+    return SweatCI::Memory::getUsage(SweatCI::MEMORY_COMMANDS).bytes;
+}
+
+int main() {
+    SweatCI::setPrintCallback(nullptr, Test::capturePrint);
+
+    SweatCI::Command pending("pending", 0, 0, nop, "not registered yet");
+    CHECK(pending.getUsage() == "not registered yet");
+
+    SweatCI::registerCommand(pending);
+    SweatCI::Command* pCommand = nullptr;
+    CHECK(SweatCI::Command::getCommand("pending", pCommand, false));
+    CHECK(pCommand->getUsage() == "not registered yet");
+    CHECK(pending.getUsage() == "not registered yet");
+
+    // commands that are never registered or refused do not take a slot
+    size_t before = commandBytes();
+    for (int i = 0; i < 1000; ++i) {
+        SweatCI::Command temporary("temporary" + std::to_string(i), 0, 0, nop, "some usage long enough to be on the heap");
+        SweatCI::registerCommand(SweatCI::Command("not valid", 0, 0, nop, "some usage long enough to be on the heap"));
+    }
+    CHECK(commandBytes() == before);
+
+    // a command registered again and again reuses the slot of the one deleted before it
+    SweatCI::registerCommand("again", 0, 0, nop, "some usage long enough to be on the heap");
+    CHECK(SweatCI::Command::deleteCommand("again")); // the list of free slots is allocated once
+    SweatCI::registerCommand("again", 0, 0, nop, "some usage long enough to be on the heap");
+    before = commandBytes();
+    for (int i = 0; i < 1000; ++i) {
+        CHECK(SweatCI::Command::deleteCommand("again"));
+        SweatCI::registerCommand("again", 0, 0, nop, "some usage long enough to be on the heap");
+    }
+    CHECK(commandBytes() == before);
+
+    CHECK(SweatCI::Command::getCommand("again", pCommand, false));
+    SweatCI::Command copy = *pCommand;
+    CHECK(SweatCI::Command::deleteCommand("again"));
+    SweatCI::registerCommand("other", 0, 0, nop, "other usage");
+    CHECK(copy.getUsage().empty());
+
+    CHECK(SweatCI::Command::getCommand("other", pCommand, false));
+    copy = *pCommand;
+    SweatCI::Command::clear();
+    SweatCI::registerCommand("new", 0, 0, nop, "new usage");
+    CHECK(copy.getUsage().empty());
+    CHECK(SweatCI::Command::getCommand("new", pCommand, false));
+    CHECK(pCommand->getUsage() == "new usage");
+
+    return Test::result();
+}
@@ -0,0 +1,46 @@
+#include "test.h"
+
+// values of clamped cvars are clamped however their setter reads them, and anything that is not one number is rejected
+int main() {
+    std::unordered_map<std::string, std::string> variables;
+    SweatCI::setPrintCallback(nullptr, Test::capturePrint);
+    SweatCI::BaseCommands::init(&variables);
+
+    int integer = 50;
+    float floating = 1;
+    SweatCI::CVARStorage::setCvar("t_int", &integer, SweatCI::Utils::Cvar::setInteger, SweatCI::Utils::Cvar::getInteger, "", 0, 0, 100);
+    SweatCI::CVARStorage::setCvar("t_float", &floating, SweatCI::Utils::Cvar::setFloat, SweatCI::Utils::Cvar::getFloat, "", 0, 0.5, 2);
+
+    Test::run("t_int 500", &variables);
+    CHECK(integer == 100);
+
+    Test::run("t_int -5", &variables);
+    CHECK(integer == 0);
+
+    Test::run("t_int 42", &variables);
+    CHECK(integer == 42);
+
+    // cvars take one argument, so this is "500 x"
+    Test::run("t_int 500 x", &variables);
+    CHECK(integer == 42);
+    CHECK(Test::countOutput("must be a number") == 1);
+
+    Test::run("t_int 500x", &variables);
+    CHECK(integer == 42);
+    CHECK(Test::countOutput("must be a number") == 2);
+
+    Test::run("t_int abc", &variables);
+    CHECK(integer == 42);
+
+    // strtod reads hexadecimal, stoi stops at the x, what setInteger stored is what is clamped
+    Test::run("t_int 0x1000", &variables);
+    CHECK(integer == 0);
+
+    Test::run("t_float 9.5", &variables);
+    CHECK(floating == 2);
+
+    Test::run("t_float \" 0.75 \"", &variables);
+    CHECK(floating == 0.75f);
+
+    return Test::result();
+}
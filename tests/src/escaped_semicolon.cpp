@@ -0,0 +1,18 @@
+#include "test.h"
+
+// "\;" is part of a token and does not end the statement, it used to make the lexer return empty tokens forever
+int main() {
+    std::unordered_map<std::string, std::string> variables;
+    SweatCI::setPrintCallback(nullptr, Test::capturePrint);
+    SweatCI::BaseCommands::init(&variables);
+
+    Test::run("echo a\\;b; echo c", &variables);
+    CHECK(Test::countOutput("a\\;b") == 1);
+    CHECK(Test::countOutput("c\n") == 1);
+
+    Test::run("\\;", &variables);
+    Test::run("echo \\;\\;; echo d", &variables);
+    CHECK(Test::countOutput("d\n") == 1);
+
+    return Test::result();
+}
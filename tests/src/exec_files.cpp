@@ -0,0 +1,46 @@
+#include <fstream>
+#include <sys/time.h>
+
+#include "test.h"
+
+/*
+ * execConfigFiles loads every file before running the first one, but a file the ones before it rewrote
+ * or created has to run with what it has when its turn comes.
+ */
+
+static std::unordered_map<std::string, std::string> variables;
+
+static void writeFiles(SweatCI::CommandContext&) {
+    std::ofstream("exec_files_b.cfg") << "echo fresh\n"; // the same size as before
+    std::ofstream("exec_files_c.cfg") << "echo created\n";
+}
+
+int main() {
+    SweatCI::setPrintCallback(nullptr, Test::capturePrint);
+    SweatCI::BaseCommands::init(&variables);
+    SweatCI::registerCommand("write_files", 0, 0, writeFiles, "");
+
+    std::remove("exec_files_c.cfg");
+    std::ofstream("exec_files_a.cfg") << "echo first\nwrite_files\n";
+    std::ofstream("exec_files_b.cfg") << "echo stale\n";
+
+    // as if the files and the working directory last changed long ago, so nothing is loaded again for being written in the same second
+    struct timeval times[2];
+    gettimeofday(&times[0], nullptr);
+    times[0].tv_sec -= 3600;
+    times[1] = times[0];
+    for (const char* path : {".", "exec_files_a.cfg", "exec_files_b.cfg"})
+        utimes(path, times);
+
+    SweatCI::CommandContext ctx;
+    ctx.runningFrom = SweatCI::CONSOLE;
+    SweatCI::execConfigFiles(ctx, {"exec_files_a.cfg", "exec_files_b.cfg", "exec_files_c.cfg"}, &variables, 2);
+
+    CHECK(Test::countOutput("first") == 1);
+    CHECK(Test::countOutput("fresh") == 1);
+    CHECK(Test::countOutput("stale") == 0);
+    CHECK(Test::countOutput("created") == 1);
+    CHECK(Test::countOutput("could not load") == 0);
+
+    return Test::result();
+}
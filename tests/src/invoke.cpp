@@ -0,0 +1,76 @@
+#include "test.h"
+
+#include <stdexcept>
+
+static std::vector<std::string> calls;
+
+static void record(SweatCI::CommandContext& ctx) {
+    std::string call = ctx.pCommand->name + ' ' + std::to_string(ctx.runningFrom);
+    for (const auto& argument : ctx.args)
+        call += " [" + argument + ']';
+    calls.push_back(call);
+}
+
+static void nested(SweatCI::CommandContext& ctx) {
+    SweatCI::invoke("t", 1.5, true);
+    calls.push_back("nested still has " + ctx.args[0]);
+}
+
+static void fail(SweatCI::CommandContext&) {
+    throw std::runtime_error("fail");
+}
+
+int main() {
+    std::unordered_map<std::string, std::string> variables;
+    SweatCI::setPrintCallback(nullptr, Test::capturePrint);
+    SweatCI::BaseCommands::init(&variables);
+
+    SweatCI::registerCommand("t", 0, 3, record, "");
+    SweatCI::registerCommand("one", 1, 1, record, "");
+    SweatCI::registerCommand("nested", 1, 1, nested, "");
+    SweatCI::registerCommand("fail", 0, 0, fail, "");
+
+    int integer = 0;
+    SweatCI::CVARStorage::setCvar("t_int", &integer, SweatCI::Utils::Cvar::setInteger, SweatCI::Utils::Cvar::getInteger, "");
+
+    SweatCI::CommandHandle handle("t_int");
+    CHECK(SweatCI::invoke(handle, 5) && integer == 5);
+
+    CHECK(SweatCI::invoke("t", "a", std::string("b"), -3));
+    CHECK(calls.back() == "t 16 [a] [b] [-3]");
+
+    CHECK(!SweatCI::invoke("t", 1, 2, 3, 4));
+    CHECK(SweatCI::invoke("one", "x", "y z") && calls.back() == "one 16 [x y z]");
+    CHECK(!SweatCI::invoke("missing"));
+
+    CHECK(SweatCI::invoke("nested", "keep"));
+    CHECK(calls.back() == "nested still has keep" && calls[calls.size()-2] == "t 16 [1.5] [1]");
+
+    // the handle finds the command again once commands are deleted
+    SweatCI::Command::deleteCommand("t");
+    CHECK(SweatCI::invoke(handle, 7) && integer == 7);
+
+    // a wait has no Parser to stop, the next input must not be suspended by it
+    CHECK(SweatCI::invoke("wait", 3));
+    Test::output().clear();
+    Test::run("echo a; echo b", &variables);
+    CHECK(Test::countOutput("a\n") == 1 && Test::countOutput("b\n") == 1);
+    CHECK(SweatCI::Scheduler::size() == 0);
+
+    // nor the one running the command that invoked it
+    SweatCI::registerCommand("waitInvoke", 0, 0, [](SweatCI::CommandContext&) { SweatCI::invoke("wait", 2); }, "");
+    Test::output().clear();
+    Test::run("waitInvoke; echo c", &variables);
+    CHECK(Test::countOutput("c\n") == 1 && SweatCI::Scheduler::size() == 0);
+
+    // throwing gives the context back
+    for (int i = 0; i < 3; ++i) {
+        try {
+            SweatCI::invoke("fail");
+            CHECK(false);
+        } catch (const std::runtime_error&) {}
+    }
+    CHECK(SweatCI::invoke(handle, 9) && integer == 9);
+
+    return Test::result();
+}
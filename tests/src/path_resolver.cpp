@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <fstream>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "test.h"
+
+/*
+ * A relative path is looked for next to the running file, then in the working directory and then in each search path.
+ * The cache must never say a file is missing after it was created, even in a directory that last changed long ago.
+ */
+
+static std::unordered_map<std::string, std::string> variables;
+
+static void createLate(SweatCI::CommandContext&) {
+    std::ofstream("path_resolver_late/late.cfg") << "echo created_late\n";
+}
+
+/// @brief moves the modification time of directory an hour back, as if nothing was created in it since
+static void age(const char* directory) {
+    struct timeval times[2];
+    gettimeofday(&times[0], nullptr);
+    times[0].tv_sec -= 3600;
+    times[1] = times[0];
+    utimes(directory, times);
+}
+
+int main() {
+    SweatCI::setPrintCallback(nullptr, Test::capturePrint);
+    SweatCI::BaseCommands::init(&variables);
+    SweatCI::registerCommand("create_late", 0, 0, createLate, "");
+
+    for (const char* directory : {"path_resolver_from", "path_resolver_search1", "path_resolver_search2", "path_resolver_late"})
+        mkdir(directory, 0755);
+    for (const char* path : {"path_resolver_from/a.cfg", "path_resolver_a.cfg", "path_resolver_search1/a.cfg",
+                             "path_resolver_b.cfg", "path_resolver_search1/b.cfg",
+                             "path_resolver_search1/c.cfg", "path_resolver_search2/c.cfg"})
+        std::ofstream(path) << "\n";
+    std::remove("path_resolver_late/late.cfg");
+    std::ofstream("path_resolver_late/main.cfg") << "exec late.cfg\ncreate_late\nexec late.cfg\n";
+
+    for (const char* directory : {".", "path_resolver_from", "path_resolver_late", "path_resolver_search1", "path_resolver_search2"})
+        age(directory);
+
+    SweatCI::PathResolver::setSearchPaths({"path_resolver_search1", "path_resolver_search2"});
+    const std::string fromFile = "path_resolver_from/main.cfg";
+    std::string resolved;
+
+    // a.cfg is everywhere, b.cfg is not next to the running file, c.cfg is only in the search paths
+    CHECK(SweatCI::PathResolver::resolve("path_resolver_a.cfg", "", resolved) && resolved == "path_resolver_a.cfg");
+    CHECK(SweatCI::PathResolver::resolve("a.cfg", fromFile, resolved) && resolved == "path_resolver_from/a.cfg");
+    CHECK(SweatCI::PathResolver::resolve("path_resolver_b.cfg", fromFile, resolved) && resolved == "path_resolver_b.cfg");
+    CHECK(SweatCI::PathResolver::resolve("b.cfg", fromFile, resolved) && resolved == "path_resolver_search1/b.cfg");
+    CHECK(SweatCI::PathResolver::resolve("c.cfg", fromFile, resolved) && resolved == "path_resolver_search1/c.cfg");
+    CHECK(!SweatCI::PathResolver::resolve("d.cfg", fromFile, resolved));
+    CHECK(SweatCI::PathResolver::resolve("/path_resolver_absolute/e.cfg", fromFile, resolved) && resolved == "/path_resolver_absolute/e.cfg");
+
+    // found lookups are answered from the cache until the next outermost exec
+    unsigned long long probes = SweatCI::PathResolver::getProbeCount();
+    CHECK(SweatCI::PathResolver::resolve("a.cfg", fromFile, resolved) && resolved == "path_resolver_from/a.cfg");
+    CHECK(SweatCI::PathResolver::getProbeCount() == probes);
+
+    // a missing file is cached while its directory looks unchanged, then the file is created within the same exec
+    SweatCI::CommandContext ctx;
+    ctx.runningFrom = SweatCI::CONSOLE;
+    SweatCI::execConfigFile(ctx, "path_resolver_late/main.cfg", &variables);
+
+    CHECK(Test::countOutput("could not load file \"late.cfg\"") == 1);
+    CHECK(Test::countOutput("created_late") == 1);
+
+    return Test::result();
+}
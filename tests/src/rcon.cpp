@@ -0,0 +1,93 @@
+#include "test.h"
+#include "SweatCI_rcon.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static int connectTo(unsigned short port) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static void sendAll(int fd, const std::string& data) {
+    for (size_t sent = 0; sent < data.size();) {
+        ssize_t size = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (size <= 0)
+            return;
+        sent += static_cast<size_t>(size);
+    }
+}
+
+static void pollFor(SweatCI::RconServer& server, int milliseconds) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+    while (std::chrono::steady_clock::now() < end)
+        server.poll(5);
+}
+
+int main() {
+    std::unordered_map<std::string, std::string> variables;
+    SweatCI::setPrintCallback(nullptr, Test::capturePrint);
+    SweatCI::BaseCommands::init(&variables);
+    SweatCI::registerCommand("boom", 0, 0, [](SweatCI::CommandContext&) { throw std::runtime_error("boom"); }, "");
+
+    SweatCI::RconServer server("password", &variables);
+    CHECK(server.listenTcp("127.0.0.1", 0));
+
+    // a peer that never sends a newline is disconnected once it sent more than a line, before it is authenticated
+    int flooding = connectTo(server.getPort());
+    CHECK(flooding != -1);
+    pollFor(server, 50);
+    CHECK(server.getClientCount() == 1);
+
+    std::thread flood([flooding]() { sendAll(flooding, std::string(4 << 20, 'x')); });
+    pollFor(server, 500);
+    CHECK(server.getClientCount() == 0);
+    shutdown(flooding, SHUT_RDWR);
+    flood.join();
+    close(flooding);
+
+    // a peer that never sends the password is disconnected after authTimeoutMilliseconds
+    server.authTimeoutMilliseconds = 100;
+    int idle = connectTo(server.getPort());
+    pollFor(server, 50);
+    CHECK(server.getClientCount() == 1);
+    pollFor(server, 150);
+    CHECK(server.getClientCount() == 0);
+    close(idle);
+
+    // a command that throws leaves the host's print callback in place
+    int admin = connectTo(server.getPort());
+    sendAll(admin, "password\nboom\n");
+    bool thrown = false;
+    try {
+        pollFor(server, 100);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(SweatCI::printCallback == Test::capturePrint);
+
+    Test::output().clear();
+    SweatCI::print(SweatCI::OutputLevel::ECHO, "host\n");
+    CHECK(Test::countOutput("host") == 1);
+    close(admin);
+
+    return Test::result();
+}
@@ -0,0 +1,65 @@
+#include <fstream>
+
+#include "test.h"
+
+/*
+ * A session that uses every way the host has to run something is recorded and replayed,
+ * the replay has to print the same things in the same order.
+ */
+
+static std::unordered_map<std::string, std::string> variables;
+
+static void session() {
+    Test::run("alias greet \"echo hello; echo world\"", &variables);
+
+    // a parse split over frames by its budget
+    SweatCI::CommandContext ctx;
+    ctx.runningFrom = SweatCI::CONSOLE;
+    SweatCI::Lexer lexer{ctx, "echo one; greet; echo two; echo three"};
+    SweatCI::ParserState state;
+    bool done = SweatCI::Parser(&lexer, &variables).parse(state, 1);
+    CHECK(!done);
+    CHECK(state.recordId != 0);
+
+    // a file the host loads and runs on its own
+    SweatCI::ParserState fileState;
+    CHECK(SweatCI::loadConfigFile(ctx, "recorder.cfg", fileState));
+
+    while (!done) {
+        SweatCI::Scheduler::tick(&variables);
+        SweatCI::invoke("echo", "invoked");
+        done = SweatCI::Parser(state, &variables).parse(state, 2);
+    }
+
+    SweatCI::Parser(fileState, &variables).parse();
+    Test::run("echo before; wait; echo after", &variables);
+    SweatCI::Scheduler::tick(&variables);
+}
+
+int main() {
+    SweatCI::setPrintCallback(nullptr, Test::capturePrint);
+    SweatCI::BaseCommands::init(&variables);
+
+    std::ofstream("recorder.cfg") << "echo from the file\necho second line\n";
+
+    CHECK(SweatCI::Recorder::start("recorder.rec"));
+    session();
+    SweatCI::Recorder::stop();
+
+    std::vector<std::string> recorded = Test::output();
+    CHECK(Test::countOutput("invoked") > 1); // the parse was split over some frames
+    CHECK(Test::countOutput("after") == 1);
+
+    Test::output().clear();
+    SweatCI::AliasGraph::clear();
+    SweatCI::Scheduler::clear();
+
+    SweatCI::ReplayStats stats;
+    CHECK(SweatCI::replayRecording("recorder.rec", &variables, false, stats));
+    CHECK(Test::output() == recorded);
+    if (Test::output() != recorded)
+        for (const auto& message : Test::output())
+            std::cerr << "replayed: " << message;
+
+    return Test::result();
+}
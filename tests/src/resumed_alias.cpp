@@ -0,0 +1,42 @@
+#include "test.h"
+
+// a Parser resumed from a ParserState knows which aliases were running, so recursion is stopped at the same point
+// whether the input runs at once or one statement at a time
+static std::vector<std::string> runSliced(const std::string& input, std::unordered_map<std::string, std::string>* pVariables) {
+    Test::output().clear();
+
+    SweatCI::CommandContext ctx;
+    ctx.runningFrom = SweatCI::CONSOLE;
+    SweatCI::Lexer lexer{ctx, input};
+    SweatCI::ParserState state;
+
+    bool done = SweatCI::Parser(&lexer, pVariables).parse(state, 1);
+    while (!done)
+        done = SweatCI::Parser(state, pVariables).parse(state, 1);
+
+    // a host loop may resume it once more after it ended
+    CHECK(state.lexers.empty());
+    CHECK(SweatCI::Parser(state, pVariables).parse(state, 1));
+    SweatCI::Parser(state, pVariables).parse();
+    CHECK(state.lexers.empty());
+
+    return Test::output();
+}
+
+int main() {
+    std::unordered_map<std::string, std::string> variables;
+    SweatCI::setPrintCallback(nullptr, Test::capturePrint);
+    SweatCI::BaseCommands::init(&variables);
+
+    const std::string input = "alias a \"echo x; a\"; a; echo after";
+
+    Test::output().clear();
+    Test::run(input, &variables);
+    std::vector<std::string> whole = Test::output();
+    CHECK(Test::countOutput("x\n") == 1);
+
+    std::vector<std::string> sliced = runSliced(input, &variables);
+    CHECK(sliced == whole);
+
+    return Test::result();
+}
@@ -0,0 +1,24 @@
+#include "test.h"
+
+#include <sstream>
+
+static std::string strip(const std::string& text, size_t& lineCount) {
+    std::istringstream input(text);
+    lineCount = 0;
+    return SweatCI::stripComments(input, lineCount);
+}
+
+// a line that ends right after "*/" must not carry the index fix up into the next line, which read line[-1]
+int main() {
+    size_t lineCount = 0;
+
+    CHECK(strip("a /* x */\nb\n", lineCount) == "a \nb\n\n");
+    CHECK(lineCount == 3);
+
+    CHECK(strip("/* x\ny */\nc // d\n", lineCount) == "\nc \n\n");
+    CHECK(lineCount == 4);
+
+    CHECK(strip("e /* x */ f\n\"/* g */\"\n", lineCount) == "e  f\n\"/* g */\"\n\n");
+
+    return Test::result();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "SweatCI.h"
+
+/*
+ * Shared by the tests: CHECK reports every failed condition and main returns Test::result().
+ */
+namespace Test {
+    inline int& failures() {
+        static int count = 0;
+        return count;
+    }
+
+    inline int result() {
+        if (failures() != 0)
+            std::cerr << failures() << " check(s) failed\n";
+        return failures() == 0 ? 0 : 1;
+    }
+
+    /// @brief everything printed, one message each
+    inline std::vector<std::string>& output() {
+        static std::vector<std::string> messages;
+        return messages;
+    }
+
+    inline void capturePrint(void*, const SweatCI::OutputLevel&, const std::string& message) {
+        output().push_back(message);
+    }
+
+    /// @return how many messages printed contain text
+    inline size_t countOutput(const std::string& text) {
+        size_t count = 0;
+        for (const auto& message : output())
+            count += message.find(text) != std::string::npos;
+        return count;
+    }
+
+    inline void run(const std::string& input, std::unordered_map<std::string, std::string>* pVariables, unsigned short runningFrom = SweatCI::CONSOLE) {
+        SweatCI::CommandContext ctx;
+        ctx.runningFrom = runningFrom;
+
+        SweatCI::Lexer lexer{ctx, input};
+        SweatCI::Parser(&lexer, pVariables).parse();
+    }
+}
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr << __FILE__ << ':' << __LINE__ << ": " << #condition << '\n'; \
+            ++Test::failures(); \
+        } \
+    } while (false)
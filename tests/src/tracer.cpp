@@ -0,0 +1,48 @@
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+#include "test.h"
+
+/*
+ * Tracer::start drops the buffers of the previous session while another thread keeps recording into its own.
+ */
+
+int main() {
+    SweatCI::setPrintCallback(nullptr, Test::capturePrint);
+    SweatCI::Tracer::start(64);
+
+    std::atomic<bool> done{false};
+    std::atomic<unsigned long long> events{0};
+    std::thread worker([&done, &events]() {
+        SweatCI::CommandContext ctx;
+        ctx.filePath = "worker.cfg";
+        std::string name = "a name longer than the small string buffer";
+
+        while (!done) {
+            SweatCI::Tracer::begin("command", name, &ctx);
+            SweatCI::Tracer::end("command");
+            ++events;
+        }
+    });
+
+    for (int i = 0; i < 200; ++i) {
+        SweatCI::Tracer::start(64);
+        std::this_thread::yield();
+    }
+
+    // the worker only moves to the last session's buffer on its next event
+    unsigned long long before = events;
+    while (events < before + 2)
+        std::this_thread::yield();
+
+    done = true;
+    worker.join();
+    SweatCI::Tracer::stop();
+
+    std::stringstream trace;
+    SweatCI::Tracer::exportChromeTrace(trace);
+    CHECK(trace.str().find("\"name\":\"a name longer than the small string buffer\",\"args\":{\"file\":\"worker.cfg\"") != std::string::npos);
+
+    return Test::result();
+}